@@ -0,0 +1,298 @@
+// Micro-benchmarks of the solver kernels on synthetic grids, no input files needed.
+//
+// Usage: fluidchen_bench [--nx N] [--ny N] [--density D] [--reps N] [--seed S]
+//
+// The synthetic grid is a channel with inflow on the left, outflow on the right,
+// a moving lid and hot and cold walls at the top and bottom, and randomly
+// placed 2x2 obstacles covering the given fraction of the interior cells.
+//
+// Every kernel is run reps times. Reported are the mean and the standard
+// deviation of the time per processed cell and the effective bandwidth, based
+// on a minimal traffic model which counts each touched double once per cell.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Boundary.hpp"
+#include "Discretization.hpp"
+#include "Domain.hpp"
+#include "Enums.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+#include "Output.hpp"
+#include "PressureSolver.hpp"
+
+namespace {
+
+struct BenchSettings {
+    int nx{512};
+    int ny{512};
+    double density{0.1};
+    int reps{20};
+    unsigned seed{42};
+};
+
+/// Keeps the compiler from removing the kernel evaluations
+volatile double sink;
+
+std::vector<std::vector<int>> synthetic_geometry(const BenchSettings &settings) {
+    const int nx = settings.nx;
+    const int ny = settings.ny;
+    std::vector<std::vector<int>> geometry(nx + 2, std::vector<int>(ny + 2, 0));
+
+    for (int i = 0; i < nx + 2; ++i) {
+        geometry[i][0] = (i <= nx / 2) ? 4 : 3;
+        geometry[i][ny + 1] = (i <= nx / 2) ? LidDrivenCavity::moving_wall_id : 3;
+    }
+    for (int j = 1; j < ny + 1; ++j) {
+        geometry[0][j] = 1;
+        geometry[nx + 1][j] = 2;
+    }
+    geometry[0][0] = geometry[0][ny + 1] = 6;
+    geometry[nx + 1][0] = geometry[nx + 1][ny + 1] = 6;
+
+    // Obstacles keep one fluid cell distance to the domain boundary
+    std::mt19937 gen(settings.seed);
+    std::uniform_int_distribution<int> rand_i(2, std::max(2, nx - 2));
+    std::uniform_int_distribution<int> rand_j(2, std::max(2, ny - 2));
+    long target = static_cast<long>(settings.density * nx * ny);
+    long covered = 0;
+    for (long attempt = 0; covered < target && attempt < 100L * nx * ny; ++attempt) {
+        int i = rand_i(gen);
+        int j = rand_j(gen);
+        for (int di = 0; di < 2; ++di) {
+            for (int dj = 0; dj < 2; ++dj) {
+                if (i + di < nx && j + dj < ny && geometry[i + di][j + dj] == 0) {
+                    geometry[i + di][j + dj] = 6;
+                    ++covered;
+                }
+            }
+        }
+    }
+    return geometry;
+}
+
+struct Result {
+    std::string name;
+    long cells;
+    double bytes_per_cell;
+    std::vector<double> seconds;
+};
+
+Result run(const std::string &name, long cells, double bytes_per_cell, int reps, const std::function<void()> &kernel) {
+    Result result{name, cells, bytes_per_cell, {}};
+    kernel(); // warm-up
+    for (int r = 0; r < reps; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        kernel();
+        auto end = std::chrono::steady_clock::now();
+        result.seconds.push_back(std::chrono::duration<double>(end - start).count());
+    }
+    return result;
+}
+
+void print(const Result &result) {
+    double mean = 0.0;
+    for (double s : result.seconds) mean += s;
+    mean /= result.seconds.size();
+    double var = 0.0;
+    for (double s : result.seconds) var += (s - mean) * (s - mean);
+    var /= std::max<std::size_t>(result.seconds.size() - 1, 1);
+
+    double cells = std::max(result.cells, 1L);
+    double ns_cell = mean / cells * 1e9;
+    double ns_cell_std = std::sqrt(var) / cells * 1e9;
+    double gbs = result.bytes_per_cell * cells / mean * 1e-9;
+
+    std::cout << std::left << std::setw(34) << result.name << std::right << std::setw(10) << result.cells
+              << std::fixed << std::setprecision(3) << std::setw(12) << ns_cell << std::setw(12) << ns_cell_std
+              << std::setw(10) << std::setprecision(1) << 100.0 * std::sqrt(var) / mean << "%" << std::setw(10)
+              << std::setprecision(2) << gbs << std::endl;
+}
+
+} // namespace
+
+int main(int argn, char **args) {
+    BenchSettings settings;
+    for (int k = 1; k < argn; ++k) {
+        std::string arg(args[k]);
+        bool has_value = k + 1 < argn;
+        if (arg == "--nx" && has_value) {
+            settings.nx = std::stoi(args[++k]);
+        } else if (arg == "--ny" && has_value) {
+            settings.ny = std::stoi(args[++k]);
+        } else if (arg == "--density" && has_value) {
+            settings.density = std::stod(args[++k]);
+        } else if (arg == "--reps" && has_value) {
+            settings.reps = std::stoi(args[++k]);
+        } else if (arg == "--seed" && has_value) {
+            settings.seed = std::stoul(args[++k]);
+        } else {
+            std::cout << "Usage: fluidchen_bench [--nx N] [--ny N] [--density D] [--reps N] [--seed S]" << std::endl;
+            return 1;
+        }
+    }
+    settings.nx = std::max(settings.nx, 4);
+    settings.ny = std::max(settings.ny, 4);
+    settings.reps = std::max(settings.reps, 2);
+
+    Domain domain;
+    domain.imin = 0;
+    domain.jmin = 0;
+    domain.imax = settings.nx + 2;
+    domain.jmax = settings.ny + 2;
+    domain.size_x = settings.nx;
+    domain.size_y = settings.ny;
+    domain.domain_size_x = settings.nx;
+    domain.domain_size_y = settings.ny;
+    domain.dx = 1.0 / settings.nx;
+    domain.dy = 1.0 / settings.ny;
+
+    auto geometry = synthetic_geometry(settings);
+    Grid grid(geometry, domain);
+    Discretization discretization(domain.dx, domain.dy, 0.5);
+    Fields field(grid, 0.01, 0.01, 0.001, 0.001, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0, -1.0);
+
+    // Smooth, non-trivial initial fields
+    for (int i = 0; i < grid.imaxb(); ++i) {
+        for (int j = 0; j < grid.jmaxb(); ++j) {
+            double x = i * domain.dx;
+            double y = j * domain.dy;
+            field.u(i, j) = std::sin(M_PI * x) * std::cos(M_PI * y);
+            field.v(i, j) = -std::cos(M_PI * x) * std::sin(M_PI * y);
+            field.p(i, j) = std::cos(2.0 * M_PI * x) * y;
+            field.t(i, j) = 1.0 - y;
+        }
+    }
+
+    Matrix<double> U(grid.imaxb(), grid.jmaxb());
+    Matrix<double> V(grid.imaxb(), grid.jmaxb());
+    Matrix<double> T(grid.imaxb(), grid.jmaxb());
+    for (int i = 0; i < grid.imaxb(); ++i) {
+        for (int j = 0; j < grid.jmaxb(); ++j) {
+            U(i, j) = field.u(i, j);
+            V(i, j) = field.v(i, j);
+            T(i, j) = field.t(i, j);
+        }
+    }
+
+    std::vector<std::pair<std::string, std::unique_ptr<Boundary>>> boundaries;
+    boundaries.push_back({"fixed wall", std::make_unique<FixedWallBoundary>(grid.fixed_wall_cells())});
+    boundaries.push_back(
+        {"hot wall", std::make_unique<FixedWallBoundary>(grid.hot_fixed_wall_cells(), std::map<int, double>{{4, 1.0}})});
+    boundaries.push_back({"cold wall", std::make_unique<FixedWallBoundary>(grid.cold_fixed_wall_cells(),
+                                                                           std::map<int, double>{{3, 0.0}})});
+    boundaries.push_back({"moving wall", std::make_unique<MovingWallBoundary>(grid.moving_wall_cells(), 1.0)});
+    boundaries.push_back({"inflow", std::make_unique<InflowBoundary>(grid.inflow_cells(), 1.0, 0.0)});
+    boundaries.push_back({"outflow", std::make_unique<OutflowBoundary>(grid.outflow_cells(), 0.0)});
+    std::vector<long> boundary_cells{
+        static_cast<long>(grid.fixed_wall_cells().size()), static_cast<long>(grid.hot_fixed_wall_cells().size()),
+        static_cast<long>(grid.cold_fixed_wall_cells().size()), static_cast<long>(grid.moving_wall_cells().size()),
+        static_cast<long>(grid.inflow_cells().size()), static_cast<long>(grid.outflow_cells().size())};
+
+    std::vector<std::unique_ptr<Boundary>> pressure_boundaries;
+    SOR sor(1.7);
+    LineSOR line_sor(1.7);
+    MixedPrecisionSOR mixed_sor(1.7, 8);
+    BlockedSOR blocked_sor(1.7, 4);
+    WavefrontSOR wavefront_sor(1.7);
+    ChebyshevJacobi chebyshev;
+    chebyshev.initialize(field, grid);
+
+    const long fluid = grid.fluid_cells().size();
+    const int reps = settings.reps;
+    std::vector<Result> results;
+
+    auto stencil = [&](double (*kernel)(const Matrix<double> &, const Matrix<double> &, int, int)) {
+        return [&, kernel]() {
+            double sum = 0.0;
+            for (auto elem : grid.fluid_cells()) {
+                sum += kernel(U, V, elem->i(), elem->j());
+            }
+            sink = sum;
+        };
+    };
+
+    results.push_back(
+        run("Discretization::convection_u", fluid, 16, reps, stencil(Discretization::convection_u<false>)));
+    results.push_back(
+        run("Discretization::convection_v", fluid, 16, reps, stencil(Discretization::convection_v<false>)));
+    results.push_back(run("Discretization::convection_t", fluid, 24, reps, [&]() {
+        double sum = 0.0;
+        for (auto elem : grid.fluid_cells()) {
+            sum += Discretization::convection_t<false>(U, V, T, elem->i(), elem->j());
+        }
+        sink = sum;
+    }));
+    results.push_back(run("Discretization::laplacian", fluid, 8, reps, [&]() {
+        double sum = 0.0;
+        for (auto elem : grid.fluid_cells()) {
+            sum += Discretization::laplacian<false>(field.p_matrix(), elem->i(), elem->j());
+        }
+        sink = sum;
+    }));
+
+    results.push_back(run("Fields::calculate_fluxes", fluid, 32, reps, [&]() { field.calculate_fluxes(grid); }));
+    results.push_back(
+        run("Fields::calculate_fluxes (energy)", fluid, 40, reps, [&]() { field.calculate_fluxes(grid, true); }));
+    results.push_back(run("Fields::calculate_rs", fluid, 24, reps, [&]() { field.calculate_rs(grid); }));
+    // One sweep reads and writes P, reads RS, and evaluates the residual from P and RS
+    results.push_back(
+        run("SOR::solve", fluid, 40, reps, [&]() { sink = sor.solve(field, grid, pressure_boundaries); }));
+    // Same traffic as SOR::solve, the sweep pipelined over the threads
+    results.push_back(run("WavefrontSOR::solve", fluid, 40, reps,
+                          [&]() { sink = wavefront_sor.solve(field, grid, pressure_boundaries); }));
+    // Line sweep reads P twice and RS, writes P, plus the residual evaluation
+    results.push_back(
+        run("LineSOR::solve", fluid, 48, reps, [&]() { sink = line_sor.solve(field, grid, pressure_boundaries); }));
+    // Per sweep: float E read and written, float residual and the cell index read, plus the double-precision
+    // residual, correction and residual norm passes of the solve call spread over its eight sweeps
+    results.push_back(run("MixedPrecisionSOR::solve (per sweep)", fluid * 8, 23, reps,
+                          [&]() { sink = mixed_sor.solve(field, grid, pressure_boundaries); }));
+    // Per sweep, P read and written and RS read once per tile, plus the residual evaluation over four sweeps
+    results.push_back(run("BlockedSOR::solve (per sweep)", fluid * 4, 16, reps,
+                          [&]() { sink = blocked_sor.solve(field, grid, pressure_boundaries); }));
+    // Reads P, RS and the previous iterate, writes the next one, plus the residual evaluation
+    results.push_back(run("ChebyshevJacobi::solve", fluid, 48, reps,
+                          [&]() { sink = chebyshev.solve(field, grid, pressure_boundaries); }));
+    results.push_back(
+        run("Fields::calculate_velocities", fluid, 40, reps, [&]() { field.calculate_velocities(grid); }));
+
+    for (std::size_t k = 0; k < boundaries.size(); ++k) {
+        auto &boundary = *boundaries[k].second;
+        const std::string &name = boundaries[k].first;
+        results.push_back(run("apply (" + name + ")", boundary_cells[k], 32, reps, [&]() { boundary.apply(field); }));
+        results.push_back(run("apply_pressure (" + name + ")", boundary_cells[k], 16, reps,
+                              [&]() { boundary.apply_pressure(field); }));
+        results.push_back(run("apply_temperature (" + name + ")", boundary_cells[k], 16, reps,
+                              [&]() { boundary.apply_temperature(field); }));
+    }
+
+    // Output of pressure, temperature and the three velocity components
+    std::string vtk_file = (std::filesystem::temp_directory_path() / "fluidchen_bench.vtk").string();
+    long cells = static_cast<long>(settings.nx) * settings.ny;
+    results.push_back(run("VTKOutput::write", cells, 40, std::min(reps, 5),
+                          [&]() { VTKOutput::write(vtk_file, grid, field, OutputSettings(), true); }));
+    std::remove(vtk_file.c_str());
+
+    std::cout << "Grid " << settings.nx << " x " << settings.ny << ", obstacle density " << settings.density << ", "
+              << fluid << " fluid cells, " << reps << " repetitions\n\n";
+    std::cout << std::left << std::setw(34) << "kernel" << std::right << std::setw(10) << "cells" << std::setw(12)
+              << "ns/cell" << std::setw(12) << "std" << std::setw(11) << "cv" << std::setw(10) << "GB/s" << std::endl;
+    for (auto &result : results) {
+        print(result);
+    }
+
+    return 0;
+}
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <array>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
 
 #include "Boundary.hpp"
+#include "Convergence.hpp"
+#include "Diffusion.hpp"
 #include "Discretization.hpp"
 #include "Domain.hpp"
 #include "Fields.hpp"
 #include "Grid.hpp"
+#include "GridSequence.hpp"
+#include "Monitor.hpp"
+#include "Output.hpp"
+#include "PerfCounters.hpp"
 #include "PressureSolver.hpp"
+#include "SteadyState.hpp"
+#include "StepLog.hpp"
 
 /**
  * @brief Class to hold and orchestrate the simulation flow.
@@ -58,12 +68,55 @@ class Case {
     double _t_end;
     /// Solution file outputting frequency
     double _output_freq;
+    /// Full resolution solution file outputting frequency, disabled if not positive
+    double _output_full_freq{0.0};
+    /// Field and window selection of the regular solution files
+    OutputSettings _output_settings;
+    /// Absolute error bound of compressed solution files, plain .vtk files are written if not positive
+    double _output_error_bound{0.0};
+    /// Start time of the running statistics
+    double _statistics_start{0.0};
+    /// Running statistics outputting frequency, written only at the end if not positive
+    double _statistics_freq{0.0};
 
     Fields _field;
     Grid _grid;
     Discretization _discretization;
     std::unique_ptr<PressureSolver> _pressure_solver;
     std::vector<std::unique_ptr<Boundary>> _boundaries;
+    /// Implicit diffusion line solves, null for explicit diffusion
+    std::unique_ptr<ImplicitDiffusion> _diffusion;
+    Monitor _monitor;
+    PhaseTimer _timer;
+    PerfCounters _counters;
+    ConvergenceAnalysis _convergence;
+
+    /// Set to true to analyse the convergence of the pressure solves
+    bool _convergence_analysis = false;
+
+    /// Residual history of every n-th pressure solve is written, not written if not positive
+    int _residual_history_freq = 0;
+
+    /// Set to true to tune the SOR relaxation factor at runtime (omg auto)
+    bool _omega_auto = false;
+    OmegaTuner _omega_tuner;
+    /// Tuned relaxation factors of the case, keyed by geometry and resolution
+    std::string _omega_cache;
+    std::string _omega_cache_key;
+
+    /// Set to true to stop once the run is steady
+    bool _steady = false;
+    SteadyState _steady_state;
+
+    /// Coarse-to-fine initialisation, disabled without levels
+    GridSequence _grid_sequence;
+
+    /// Inflow velocity in x and y direction
+    std::array<double, 2> _inflow_velocity{};
+    /// Outflow pressure
+    double _outflow_pressure{0.0};
+    /// Temperatures of the walls with the ids 3, 4 and 5, -1 for adiabatic walls
+    std::array<double, 3> _wall_temperature{-1.0, -1.0, -1.0};
 
     /// Set to true to enable energy equations
     bool _energy_eq = false;
@@ -71,6 +124,30 @@ class Case {
     /// Id to group results
     int _rank = 0;
 
+    /// Set to true to write the per-timestep log as binary step records
+    bool _binary_log = false;
+
+    /// Maximum number of timesteps, unlimited if not positive (--max-steps)
+    int _max_steps = 0;
+
+    /// Set to true to suppress solution, statistics and monitor files (--no-output)
+    bool _no_output = false;
+
+    /// Performance summary file, not written if empty (--bench-json)
+    std::string _bench_json;
+
+    /// Timeline file in the Chrome Trace Event format, not recorded if empty (--trace)
+    std::string _trace_file;
+
+    /// Number of pressure iterations per traced batch
+    static constexpr int trace_batch_size = 10;
+
+    /// Set to true to count hardware events per phase (--perf-counters)
+    bool _perf_counters = false;
+
+    /// Raw event config counting vector instructions, not counted if zero (--perf-vector-event)
+    uint64_t _perf_vector_event = 0;
+
     /// Solver convergence tolerance
     double _tolerance;
 
@@ -92,14 +169,73 @@ class Case {
      *
      * Outputs the solution files in .vtk format. Ghost cells are excluded.
      * Pressure is cell variable while velocity is point variable while being
-     * interpolated to the cell faces
+     * interpolated to the cell faces. Regular files honour the field, window
+     * and stride selection of the input file, full files always contain all
+     * fields over the whole domain. Regular files are written as compressed
+     * .fcz files if an output error bound is set.
      *
      * @param[in] Timestep of the solution
+     * @param[in] Id to group results
+     * @param[in] Write a full resolution file
      */
-    void output_vtk(int t, int my_rank = 0);
+    void output_vtk(int t, int my_rank = 0, bool full = false);
+
+    /**
+     * @brief Running statistics file outputter
+     *
+     * Outputs the time-averaged mean and the RMS of the fluctuations of
+     * pressure, velocity and temperature in .vtk format.
+     *
+     * @param[in] Number of the statistics output
+     */
+    void output_statistics_vtk(int t, int my_rank = 0);
+
+    /**
+     * @brief Performance summary outputter
+     *
+     * Writes time per step, pressure iterations per step, phase times and
+     * peak resident set size of the run as JSON.
+     *
+     * @param[in] number of performed timesteps
+     * @param[in] total number of pressure iterations
+     * @param[in] maximum number of pressure iterations of a timestep
+     * @param[in] wall clock time of the time loop in seconds
+     * @param[in] accumulated wall clock time of each phase in seconds
+     */
+    void output_bench_json(int steps, int64_t iterations, int max_iterations, double loop_time,
+                           const std::array<double, num_step_phases> &phase_time);
 
     void build_domain(Domain &domain, int imax_domain, int jmax_domain);
 
+    /**
+     * @brief Constructs the boundaries of the case on a grid
+     *
+     * @param[in] grid, whose cells the boundaries refer to
+     * @param[out] boundaries
+     */
+    void build_boundaries(const Grid &grid, std::vector<std::unique_ptr<Boundary>> &boundaries) const;
+
+    /**
+     * @brief Runs the coarse levels of the grid sequencing
+     *
+     * Every level is run with SOR from the result of the next coarser one
+     * until it is approximately steady or reaches the maximum time, and the
+     * result of the finest coarse level becomes the initial condition of the
+     * run. The coarse levels start at t=0 and do not write any output.
+     *
+     * @param[in] log file
+     */
+    void run_grid_sequence(std::ofstream &output_file);
+
+    /**
+     * @brief Key of the relaxation factor cache entry of the case
+     *
+     * Made of the geometry file name, the resolution and a hash of the fluid
+     * cell layout and the cell aspect ratio, which determine the optimal
+     * relaxation factor.
+     */
+    std::string omega_cache_key() const;
+
     /**
      * @brief Checks for unphysical values in velocity and pressure
      *
@@ -109,5 +245,5 @@ class Case {
      * @param[in] imax
      * @param[in] jmax
      */
-    bool check_err(Fields &field, int imax, int jmax);
+    bool check_err(const Fields &field, int imax, int jmax);
 };
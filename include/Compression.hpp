@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Output.hpp"
+
+/**
+ * @brief Error-bounded lossy compression of snapshots
+ *
+ * Every component of an array is quantised to integer multiples of twice the
+ * absolute error bound, so that each reconstructed value deviates at most by
+ * the error bound from the original one. The quantised values are predicted
+ * from their left, lower and lower left neighbours (Lorenzo predictor) and the
+ * prediction residuals are Huffman coded. The rows of each array are split
+ * into blocks which are compressed independently, and in parallel.
+ *
+ * Corner coordinates and blanked cells are stored losslessly.
+ */
+class SnapshotCompression {
+  public:
+    /**
+     * @brief Writes a compressed snapshot
+     *
+     * @param[in] output file name
+     * @param[in] snapshot to be written
+     * @param[in] absolute error bound of the stored values, must be positive
+     * @param[in] number of rows compressed together
+     * @param[in] number of threads, all hardware threads if not positive
+     */
+    static void write(const std::string &file_name, const Snapshot &snapshot, double error_bound,
+                      int rows_per_block = 32, int num_threads = 0);
+
+    /**
+     * @brief Reads and decompresses a snapshot
+     *
+     * @param[in] file name of the compressed snapshot
+     * @param[out] decompressed snapshot, empty if the file could not be read
+     */
+    static Snapshot read(const std::string &file_name);
+
+  private:
+    /**
+     * @brief Compresses a block of rows of one array component
+     *
+     * @param[in] first value of the block
+     * @param[in] distance between two values of the component
+     * @param[in] number of values per row
+     * @param[in] number of rows of the block
+     * @param[in] absolute error bound
+     * @param[out] compressed block
+     */
+    static std::vector<uint8_t> compress_block(const double *values, int stride, int width, int rows,
+                                               double error_bound);
+
+    /**
+     * @brief Decompresses a block of rows of one array component
+     *
+     * @param[in] compressed block
+     * @param[out] first value of the block
+     * @param[in] distance between two values of the component
+     * @param[in] number of values per row
+     * @param[in] number of rows of the block
+     * @param[in] absolute error bound
+     * @param[out] whether the block could be decoded
+     */
+    static bool decompress_block(const std::vector<uint8_t> &block, double *values, int stride, int width, int rows,
+                                 double error_bound);
+
+    /**
+     * @brief Runs tasks on a number of threads
+     *
+     * @param[in] number of tasks
+     * @param[in] number of threads, all hardware threads if not positive
+     * @param[in] task to be run, called with the task index
+     */
+    template <typename Task> static void run_parallel(int num_tasks, int num_threads, Task task);
+};
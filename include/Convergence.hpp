@@ -0,0 +1,213 @@
+#pragma once
+
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Convergence analysis of the iterative pressure solves
+ *
+ * Collects the residual of every pressure iteration of a solve and derives
+ * the asymptotic convergence factor rho from the residual reduction over the
+ * second half of the iterations. For SOR with relaxation factor omega below
+ * the optimum, rho is the dominant eigenvalue lambda of the iteration matrix
+ * and relates to the spectral radius mu of the Jacobi iteration by
+ *
+ *     (lambda + omega - 1)^2 = lambda omega^2 mu^2,
+ *
+ * from which the optimal relaxation factor follows as
+ *
+ *     omega_opt = 2 / (1 + sqrt(1 - mu^2)).
+ *
+ * Above the optimum, the eigenvalues are complex with modulus omega - 1 and
+ * the factor carries no information about mu.
+ *
+ * Optionally, a sampled residual history (all of the first iterations, then
+ * geometrically spaced ones and the last one) of every n-th solve is written
+ * to a CSV file.
+ */
+class ConvergenceAnalysis {
+  public:
+    /// Minimum number of sweeps of a solve to estimate its convergence factor
+    static constexpr int min_iterations = 8;
+
+    /**
+     * @brief Writes the sampled residual history to a file
+     *
+     * @param[in] output file name
+     * @param[in] history of every frequency-th solve is written
+     */
+    void open_history(const std::string &file_name, int frequency);
+
+    /// Sets the relaxation factor of the following solves
+    void set_omega(double omega);
+
+    /// Sets the number of relaxation sweeps between two recorded residuals, the factor is given per sweep
+    void set_sweeps(int sweeps);
+
+    /// Starts a pressure solve
+    void begin_solve();
+
+    /// Adds the residual of a pressure iteration
+    void add_residual(double residual);
+
+    /**
+     * @brief Finishes a pressure solve
+     *
+     * @param[in] timestep number
+     * @param[in] simulation time
+     */
+    void end_solve(int step, double t);
+
+    /// Convergence factor of the last solve, zero if it had too few iterations
+    double last_factor() const;
+
+    /// Median estimate of the Jacobi spectral radius over all solves, zero if unknown
+    double jacobi_radius() const;
+
+    /**
+     * @brief Prints the convergence summary and the relaxation factor recommendation
+     *
+     * @param[in] output stream
+     */
+    void report(std::ostream &out) const;
+
+    /**
+     * @brief Jacobi spectral radius from the SOR convergence factor
+     *
+     * @param[in] asymptotic convergence factor of SOR
+     * @param[in] relaxation factor
+     * @param[out] estimate of mu, zero if the factor is not informative
+     */
+    static double jacobi_radius(double factor, double omega);
+
+    /**
+     * @brief Optimal SOR relaxation factor of a Jacobi spectral radius
+     *
+     * @param[in] Jacobi spectral radius
+     */
+    static double optimal_omega(double mu);
+
+  private:
+    /// Whether iteration k (counted from one) of a solve is sampled
+    static bool sampled(int k, int n);
+
+    double _omega{1.0};
+    int _sweeps{1};
+    std::vector<double> _residuals;
+    double _last_factor{0.0};
+
+    /// Estimates of mu of the informative solves
+    std::vector<double> _mu;
+    /// Convergence factors and iterations of all analysed solves
+    std::vector<double> _factors;
+    long _num_solves{0};
+    long _num_iterations{0};
+    /// Number of solves with a factor close to omega - 1, i.e. omega at or above the optimum
+    long _num_overrelaxed{0};
+
+    std::ofstream _history;
+    int _history_freq{1};
+    long _history_solve{0};
+};
+
+/**
+ * @brief Runtime tuning of the SOR relaxation factor
+ *
+ * Starting below the optimum, the Jacobi spectral radius is estimated from
+ * the convergence factors of the first informative solves and omega is set
+ * to the optimum of their median. A factor close to omega - 1 shows that
+ * omega is already at or above the optimum, in which case omega is lowered
+ * until the factor becomes informative. Once tuned, the mean number of
+ * iterations per solve is compared window by window with the one of the
+ * first window after tuning, and the estimation is repeated if it drifts
+ * upwards.
+ *
+ * Tuned values can be kept in a cache file with one "key omega" entry per
+ * line, so that later runs with the same key start tuned.
+ */
+class OmegaTuner {
+  public:
+    /// Relaxation factor the estimation starts with if nothing is cached
+    static constexpr double initial_omega = 1.5;
+    /// Number of informative solves the spectral radius estimate is the median of
+    static constexpr int learn_solves = 5;
+    /// Uninformative solves after which the estimation is given up and the current omega kept
+    static constexpr int max_uninformative_solves = 50;
+    /// Number of solves of the iteration count windows
+    static constexpr int drift_window = 20;
+    /// Ratio of the mean iteration counts of a window and of the first one considered a drift
+    static constexpr double drift_ratio = 1.5;
+
+    /**
+     * @brief Starts the tuning
+     *
+     * @param[in] initial relaxation factor
+     * @param[in] whether the factor is already tuned, e.g. read from the cache
+     */
+    void start(double omega, bool tuned);
+
+    /**
+     * @brief Updates omega after a pressure solve
+     *
+     * @param[in] convergence factor of the solve, zero if unknown
+     * @param[in] number of iterations of the solve
+     * @param[out] whether omega changed
+     */
+    bool update(double factor, int iterations);
+
+    /// Current relaxation factor
+    double omega() const { return _omega; }
+
+    /// Whether omega was tuned, i.e. the estimation is not running
+    bool tuned() const { return _tuned; }
+
+    /// Whether omega was set from an estimate during this run
+    bool learned() const { return _num_estimations > 0; }
+
+    /**
+     * @brief Prints the tuning summary
+     *
+     * @param[in] output stream
+     */
+    void report(std::ostream &out) const;
+
+    /**
+     * @brief Reads a tuned relaxation factor from a cache file
+     *
+     * @param[in] cache file name
+     * @param[in] key of the entry
+     * @param[out] cached omega, zero if there is no entry
+     */
+    static double load(const std::string &file_name, const std::string &key);
+
+    /**
+     * @brief Adds or replaces the entry of a key in a cache file
+     *
+     * @param[in] cache file name
+     * @param[in] key of the entry, must not contain whitespace
+     * @param[in] tuned omega
+     */
+    static void store(const std::string &file_name, const std::string &key, double omega);
+
+  private:
+    /// Lowers omega by a quarter of its over-relaxation and restarts the estimation
+    void back_off();
+
+    double _omega{initial_omega};
+    bool _tuned{false};
+    /// Estimates of mu of the current estimation
+    std::vector<double> _mu;
+    int _uninformative{0};
+
+    /// Iteration count windows after tuning
+    double _baseline_iterations{0.0};
+    long _window_iterations{0};
+    int _window_solves{0};
+
+    double _last_mu{0.0};
+    int _num_estimations{0};
+    int _num_back_offs{0};
+    int _num_drifts{0};
+};
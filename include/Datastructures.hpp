@@ -1,11 +1,137 @@
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <memory>
 #include <vector>
 
+/**
+ * @brief Storage layout of a matrix split into square tiles
+ *
+ * Only the active tiles are allocated, one after another in the order of
+ * the list of active tiles. Each tile is stored in column major format
+ * together with a halo, a copy of the adjacent elements of its eight
+ * neighbours, so that the stencils of the elements of a tile read from the
+ * tile only. Elements of inactive tiles are read as zero and must not be
+ * written.
+ */
+struct TileMap {
+    /// Tiles are 2^shift x 2^shift elements
+    static const int shift = 4;
+    static const int tile_size = 1 << shift;
+    /// Tiles are stored with a halo of one element on each side
+    static const int halo_size = tile_size + 2;
+    /// Number of stored elements of a tile, the halo included
+    static const int tile_elements = halo_size * halo_size;
+
+    /**
+     * @brief Constructor of the layout
+     *
+     * @param[in] number of elements in x direction
+     * @param[in] number of elements in y direction
+     * @param[in] whether each tile is active, indexed tile_i + tiles_x * tile_j
+     */
+    TileMap(int i_max, int j_max, const std::vector<bool> &active_tiles)
+        : imax(i_max), jmax(j_max), tiles_x((i_max + tile_size - 1) >> shift),
+          tiles_y((j_max + tile_size - 1) >> shift), slots(tiles_x * tiles_y, -1) {
+        for (int tile = 0; tile < tiles_x * tiles_y; ++tile) {
+            if (!active_tiles.at(tile)) continue;
+            slots[tile] = static_cast<int>(active.size());
+            active.push_back(tile);
+        }
+        for (int tile : active) {
+            int ti = tile % tiles_x;
+            int tj = tile / tiles_x;
+            std::array<int, 8> slot;
+            int k = 0;
+            for (int dj = -1; dj <= 1; ++dj) {
+                for (int di = -1; di <= 1; ++di) {
+                    if (di == 0 && dj == 0) continue;
+                    bool inside = ti + di >= 0 && ti + di < tiles_x && tj + dj >= 0 && tj + dj < tiles_y;
+                    slot[k++] = inside ? slots[tile + di + tiles_x * dj] : -1;
+                }
+            }
+            neighbours.push_back(slot);
+        }
+    }
+
+    /// Tile of the element (i, j)
+    int tile(int i, int j) const { return (i >> shift) + tiles_x * (j >> shift); }
+
+    /// Position of the tile of the element (i, j) in the storage, -1 if inactive
+    int slot(int i, int j) const { return slots[tile(i, j)]; }
+
+    /// Storage index of the element (i, j), negative within inactive tiles
+    int index(int i, int j) const {
+        return slot(i, j) * tile_elements + (i & (tile_size - 1)) + 1 + halo_size * ((j & (tile_size - 1)) + 1);
+    }
+
+    /// Offset of the active tile in the given slot, its element (i, j) is stored at offset + i + halo_size * j
+    int origin(int slot) const {
+        int i0 = (active[slot] % tiles_x) << shift;
+        int j0 = (active[slot] / tiles_x) << shift;
+        return slot * tile_elements + 1 - i0 + halo_size * (1 - j0);
+    }
+
+    /// Whether the element (i, j) lies in an active tile
+    bool allocated(int i, int j) const { return slots.at(tile(i, j)) >= 0; }
+
+    /// Number of stored elements, the halos included
+    int storage() const { return static_cast<int>(active.size()) * tile_elements; }
+
+    int imax;
+    int jmax;
+    int tiles_x;
+    int tiles_y;
+    /// Storage position of every tile, -1 if inactive
+    std::vector<int> slots;
+    /// Active tiles in storage order
+    std::vector<int> active;
+    /// Slots of the neighbours of every active tile, row by row from the lower left, -1 if inactive
+    std::vector<std::array<int, 8>> neighbours;
+};
+
+/// Loop over all fluid cells of a dense matrix
+struct DenseCells {};
+
+/// Loop over the fluid cells of the active tile in the given slot
+struct TileCells {
+    int slot;
+};
+
+/**
+ * @brief Element access of a tile, with its halo, by the index operator
+ *
+ * Lets the stencils written against the index operator of Matrix run on the
+ * elements of a tile. Like a pointer, the view gives write access also if
+ * it is const.
+ */
+template <typename T> class TileView {
+  public:
+    TileView(T *data, int origin) : _data(data), _origin(origin) {}
+
+    /// Element access and modify using index, within the tile and its halo
+    T &operator()(int i, int j) const { return _data[_origin + i + TileMap::halo_size * j]; }
+
+  private:
+    T *_data;
+    int _origin;
+};
+
 /**
  * @brief General 2D data structure around std::vector, in column
- * major format.
+ * major format, or tiled if a tile map is given.
  *
+ * The index operator addresses dense storage only, so that the loops over
+ * dense matrices do not pay for the tile lookup. The loops over the cells
+ * of tiled matrices work on one tile at a time through a TileView, and get
+ * serves code which handles both storages outside of these loops.
+ *
+ * The halos of a tiled matrix are copied from the neighbouring tiles by
+ * update_halos. Writes by element access mark their tile, and loops writing
+ * through tile views call invalidate_halos, so that the stencil loops only
+ * need to update the halos of the matrices they read.
  */
 template <typename T> class Matrix {
 
@@ -35,30 +161,144 @@ template <typename T> class Matrix {
     Matrix<T>(int i_max, int j_max) : _imax(i_max), _jmax(j_max) { _container.resize(i_max * j_max); }
 
     /**
-     * @brief Element access and modify using index
+     * @brief Constructor with initial value and storage layout
+     *
+     * The elements of inactive tiles are zero.
+     *
+     * @param[in] number of elements in x direction
+     * @param[in] number of elements in y direction
+     * @param[in] initial value for the elements
+     * @param[in] tile map of the same size, dense storage if null
+     *
+     */
+    Matrix<T>(int i_max, int j_max, double init_val, std::shared_ptr<const TileMap> tiles)
+        : _imax(i_max), _jmax(j_max), _tiles(std::move(tiles)) {
+        _container.assign(_tiles ? _tiles->storage() : i_max * j_max, init_val);
+        if (_tiles) _dirty.assign(_tiles->active.size(), 0);
+    }
+
+    /**
+     * @brief Element access and modify using index, dense storage only
      *
      * @param[in] x index
      * @param[in] y index
      * @param[out] reference to the value
      */
-    T &operator()(int i, int j) { return _container.at(_imax * j + i); }
+    T &operator()(int i, int j) {
+        assert(!_tiles);
+        return _container.at(_imax * j + i);
+    }
 
     /**
-     * @brief Element access using index
+     * @brief Element access using index, dense storage only
      *
      * @param[in] x index
      * @param[in] y index
      * @param[out] value of the element
      */
-    T operator()(int i, int j) const { return _container.at(_imax * j + i); }
+    T operator()(int i, int j) const {
+        assert(!_tiles);
+        return _container.at(_imax * j + i);
+    }
+
+    /**
+     * @brief Element access and modify of tiled storage
+     *
+     * Marks the halos copied from the tile of the element as outdated.
+     * Elements of inactive tiles have no storage, accessing them throws.
+     *
+     * @param[in] x index
+     * @param[in] y index
+     * @param[out] reference to the value
+     */
+    T &tiled(int i, int j) {
+        int slot = _tiles->slot(i, j);
+        assert(slot >= 0);
+        _dirty.at(slot) = 1;
+        return _container.at(_tiles->index(i, j));
+    }
+
+    /**
+     * @brief Element access of tiled storage
+     *
+     * @param[in] x index
+     * @param[in] y index
+     * @param[out] value of the element, zero within inactive tiles
+     */
+    T tiled(int i, int j) const { return _tiles->slot(i, j) < 0 ? T() : _container.at(_tiles->index(i, j)); }
+
+    /// Element access and modify of dense or tiled storage
+    T &get(int i, int j) { return _tiles ? tiled(i, j) : _container.at(_imax * j + i); }
+
+    /// Element access of dense or tiled storage
+    T get(int i, int j) const { return _tiles ? tiled(i, j) : _container.at(_imax * j + i); }
+
+    /// View of the active tile in the given slot and its halo, an empty matrix gives an empty view
+    TileView<T> tile(int slot) { return TileView<T>(_container.data(), _tiles ? _tiles->origin(slot) : 0); }
+
+    /// View of the active tile in the given slot and its halo, read only
+    TileView<const T> tile(int slot) const {
+        return TileView<const T>(_container.data(), _tiles ? _tiles->origin(slot) : 0);
+    }
+
+    /// Marks all halos as outdated, after a loop wrote through tile views
+    void invalidate_halos() { std::fill(_dirty.begin(), _dirty.end(), 1); }
+
+    /// Copies the outdated halos from their tiles, no-op for dense storage
+    void update_halos() {
+        for (std::size_t slot = 0; slot < _dirty.size(); ++slot) {
+            if (!_dirty[slot]) continue;
+            copy_halos(slot);
+            _dirty[slot] = 0;
+        }
+    }
+
+    /**
+     * @brief Copies the elements of a tile into the halos of its neighbours
+     *
+     * @param[in] slot of the active tile
+     */
+    void copy_halos(int slot) {
+        const int n = TileMap::tile_size;
+        const int stride = TileMap::halo_size;
+        const T *own = _container.data() + slot * TileMap::tile_elements;
+        int k = 0;
+        for (int dj = -1; dj <= 1; ++dj) {
+            for (int di = -1; di <= 1; ++di) {
+                if (di == 0 && dj == 0) continue;
+                int other_slot = _tiles->neighbours[slot][k++];
+                if (other_slot < 0) continue;
+                T *other = _container.data() + other_slot * TileMap::tile_elements;
+                // The edge of the tile towards the neighbour, shifted by a tile into the halo of the neighbour
+                int i_first = di > 0 ? n - 1 : 0;
+                int i_last = di < 0 ? 0 : n - 1;
+                int j_first = dj > 0 ? n - 1 : 0;
+                int j_last = dj < 0 ? 0 : n - 1;
+                for (int j = j_first; j <= j_last; ++j) {
+                    for (int i = i_first; i <= i_last; ++i) {
+                        other[i - di * n + 1 + stride * (j - dj * n + 1)] = own[i + 1 + stride * (j + 1)];
+                    }
+                }
+            }
+        }
+    }
 
     /**
      * @brief Pointer representation of underlying data
      *
+     * Only dense matrices are indexed i + imax * j.
+     *
      * @param[out] pointer to the beginning of the vector
      */
     const T *data() const { return _container.data(); }
 
+    /**
+     * @brief Pointer representation of underlying data, modifiable
+     *
+     * @param[out] pointer to the beginning of the vector
+     */
+    T *data() { return _container.data(); }
+
     /**
      * @brief Access of the size of the structure
      *
@@ -67,19 +307,19 @@ template <typename T> class Matrix {
     int size() const { return _container.size(); }
 
     /// get the given row of the matrix
-    std::vector<double> get_row(int row) {
+    std::vector<double> get_row(int row) const {
         std::vector<T> row_data(_imax, -1);
         for (int i = 0; i < _imax; ++i) {
-            row_data.at(i) = _container.at(i + _imax * row);
+            row_data.at(i) = get(i, row);
         }
         return row_data;
     }
 
     /// get the given column of the matrix
-    std::vector<double> get_col(int col) {
+    std::vector<double> get_col(int col) const {
         std::vector<T> col_data(_jmax, -1);
         for (int i = 0; i < _jmax; ++i) {
-            col_data.at(i) = _container.at(col + i * _imax);
+            col_data.at(i) = get(col, i);
         }
         return col_data;
     }
@@ -87,14 +327,14 @@ template <typename T> class Matrix {
     /// set the given column of matrix to given vector
     void set_col(const std::vector<double> &vec, int col) {
         for (int i = 0; i < _jmax; ++i) {
-            _container.at(col + i * _imax) = vec.at(i);
+            get(col, i) = vec.at(i);
         }
     }
 
     /// set the given row of matrix to given vector
     void set_row(const std::vector<double> &vec, int row) {
         for (int i = 0; i < _imax; ++i) {
-            _container.at(i + row * _imax) = vec.at(i);
+            get(i, row) = vec.at(i);
         }
     }
 
@@ -104,6 +344,12 @@ template <typename T> class Matrix {
     /// get the number of elements in y direction
     int jmax() const { return _jmax; }
 
+    /// get the tile map, null if the storage is dense
+    const std::shared_ptr<const TileMap> &tiles() const { return _tiles; }
+
+    /// whether the element (i, j) is stored, false within inactive tiles
+    bool allocated(int i, int j) const { return !_tiles || _tiles->allocated(i, j); }
+
   private:
     /// Number of elements in x direction
     int _imax;
@@ -112,4 +358,24 @@ template <typename T> class Matrix {
 
     /// Data container
     std::vector<T> _container;
+
+    /// Tile map of tiled storage, null for dense storage
+    std::shared_ptr<const TileMap> _tiles;
+
+    /// Whether the halos copied from each active tile are outdated
+    std::vector<char> _dirty;
 };
+
+/// Element access of a matrix in a loop over all fluid cells of dense storage
+template <typename T> Matrix<T> &access(Matrix<T> &matrix, DenseCells) { return matrix; }
+
+/// Element access of a matrix in a loop over all fluid cells of dense storage, read only
+template <typename T> const Matrix<T> &access(const Matrix<T> &matrix, DenseCells) { return matrix; }
+
+/// Element access of a matrix in a loop over the fluid cells of a tile
+template <typename T> TileView<T> access(Matrix<T> &matrix, TileCells cells) { return matrix.tile(cells.slot); }
+
+/// Element access of a matrix in a loop over the fluid cells of a tile, read only
+template <typename T> TileView<const T> access(const Matrix<T> &matrix, TileCells cells) {
+    return matrix.tile(cells.slot);
+}
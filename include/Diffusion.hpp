@@ -0,0 +1,96 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include "Boundary.hpp"
+#include "Datastructures.hpp"
+#include "Enums.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Implicit diffusion of the velocities and the temperature
+ *
+ * Turns the explicit updates of F, G and T into backward Euler steps of
+ * their diffusion terms, approximately factorized into alternating-direction
+ * implicit line solves for the change of the field (delta form):
+ *
+ *     (1 - dt k Lx) (1 - dt k Ly) (A_new - A) = A_explicit - A,
+ *
+ * one tridiagonal system per line of unknowns in x, then one per line in y.
+ * The step is unconditionally stable, so the timestep size is bounded by
+ * the convective CFL condition only, and a steady state is the one of the
+ * explicit update for any timestep size. For the velocities, the pressure
+ * gradient of the previous step is moved from the projection into the
+ * implicit step: the change is solved for without it and the gradient is
+ * added back, otherwise the projection would balance a filtered gradient
+ * and the steady state would depend on dt. The unknowns of U are the faces
+ * between two fluid cells, those of V likewise, those of T the fluid cells.
+ *
+ * Beyond the ends of a line, the boundary conditions set the change of the
+ * field to weight * (change at the line end). The weights are found once
+ * by applying the boundary conditions to unknowns set to zero and to one,
+ * e.g. -1 for tangential velocities at no-slip walls and 0 for the normal
+ * ones.
+ */
+class ImplicitDiffusion {
+  public:
+    /**
+     * @brief Finds the lines of unknowns and the boundary weights
+     *
+     * The fields are restored after the boundary conditions were probed.
+     *
+     * @param[in] grid
+     * @param[in] fields the boundary conditions are probed on
+     * @param[in] boundaries
+     * @param[in] whether the temperature is solved for
+     */
+    ImplicitDiffusion(const Grid &grid, Fields &field, const std::vector<std::unique_ptr<Boundary>> &boundaries,
+                      bool energy_eq);
+
+    /**
+     * @brief Turns an explicit update into the implicit diffusion step
+     *
+     * @param[in] field type, U, V or T
+     * @param[in,out] explicit update, overwritten by the implicit one at the unknowns
+     * @param[in] current values of the field
+     * @param[in] diffusion coefficient times timestep size
+     * @param[in] pressure of the previous step for U and V, null for T
+     * @param[in] timestep size, used with the pressure
+     */
+    void solve(field_type type, Matrix<double> &update, const Matrix<double> &current, double kdt,
+               const Matrix<double> *pressure = nullptr, double dt = 0.0) const;
+
+  private:
+    /// Line of unknowns first, first + stride, ..., with the boundary weights beyond its ends
+    struct Line {
+        int first;
+        int length;
+        double lower_weight;
+        double upper_weight;
+    };
+
+    /// Lines of a field in x (stride 1) and in y (stride imaxb)
+    struct Lines {
+        std::array<std::vector<Line>, 2> direction;
+        int max_length{0};
+    };
+
+    /**
+     * @brief Finds the lines of the unknowns of a field
+     *
+     * @param[in] unknown flags by linear index
+     * @param[in] boundary value with the unknowns at zero
+     * @param[in] boundary value with the unknowns at one
+     */
+    Lines find_lines(const std::vector<char> &unknown, const Matrix<double> &zero, const Matrix<double> &one) const;
+
+    int _imaxb;
+    int _jmaxb;
+    double _dx;
+    double _dy;
+    /// Lines of U, V and T
+    std::array<Lines, 3> _lines;
+};
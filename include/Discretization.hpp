@@ -1,10 +1,18 @@
 #pragma once
 
+#include <type_traits>
+#include <vector>
+
 #include "Datastructures.hpp"
 
+class Grid;
+
 /**
  * @brief Static discretization methods to modify the fields
  *
+ * The stencils are templates on whether the grid is stretched and on the
+ * element access of the fields, a dense Matrix or the TileView of a tile.
+ * The loops over the cells choose the grid variant once by run.
  */
 class Discretization {
   public:
@@ -19,6 +27,17 @@ class Discretization {
      */
     Discretization(double dx, double dy, double gamma);
 
+    /**
+     * @brief Constructor to set the discretization parameters of a grid
+     *
+     * The cell sizes of stretched grids are taken per column and row, the
+     * stencils then weight their neighbours by the distances between them.
+     *
+     * @param[in] grid
+     * @param[in] upwinding coefficient
+     */
+    Discretization(const Grid &grid, double gamma);
+
     /**
      * @brief Diffusion discretization in 2D using central differences
      *
@@ -39,7 +58,7 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double convection_u(const Matrix<double> &U, const Matrix<double> &V, int i, int j);
+    template <bool stretched, typename M> static double convection_u(const M &U, const M &V, int i, int j);
     
     /**
      * @brief Convection in y direction using donor-cell scheme
@@ -51,7 +70,7 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double convection_v(const Matrix<double> &U, const Matrix<double> &V, int i, int j);
+    template <bool stretched, typename M> static double convection_v(const M &U, const M &V, int i, int j);
 
     /**
      * @brief Convection of temperature using donor-cell scheme
@@ -64,8 +83,7 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double convection_t(const Matrix<double> &U, const Matrix<double> &V, const Matrix<double> &T,
-                              int i, int j);
+    template <bool stretched, typename M> static double convection_t(const M &U, const M &V, const M &T, int i, int j);
                               
     /**
      * @brief Laplacian term discretization using central difference
@@ -76,7 +94,36 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double laplacian(const Matrix<double> &P, int i, int j);
+    template <bool stretched, typename M> static double laplacian(const M &P, int i, int j);
+
+    /// Laplacian with the stencil of the current grid, for loops over dense matrices not dispatched by run
+    static double laplacian(const Matrix<double> &P, int i, int j) {
+        return _stretched ? laplacian<true>(P, i, j) : laplacian<false>(P, i, j);
+    }
+
+    /**
+     * @brief Laplacian of the x-velocity at the right face of cell (i,j)
+     *
+     * Same as laplacian on uniform grids.
+     *
+     * @param[in] x-velocity field
+     * @param[in] x index
+     * @param[in] y index
+     * @param[out] result
+     */
+    template <bool stretched, typename M> static double laplacian_u(const M &U, int i, int j);
+
+    /**
+     * @brief Laplacian of the y-velocity at the top face of cell (i,j)
+     *
+     * Same as laplacian on uniform grids.
+     *
+     * @param[in] y-velocity field
+     * @param[in] x index
+     * @param[in] y index
+     * @param[out] result
+     */
+    template <bool stretched, typename M> static double laplacian_v(const M &V, int i, int j);
 
     /**
      * @brief Terms of laplacian needed for SOR, i.e. excluding unknown value at
@@ -88,11 +135,47 @@ class Discretization {
      * @param[out] result
      *
      */
-    static double sor_helper(const Matrix<double> &P, int i, int j);
+    template <bool stretched, typename M> static double sor_helper(const M &P, int i, int j);
+
+    /**
+     * @brief Coefficient of the unknown value at (i,j) in the laplacian,
+     * with the opposite sign
+     *
+     * @param[in] x index
+     * @param[in] y index
+     * @param[out] result
+     */
+    template <bool stretched> static double sor_diagonal(int i, int j);
+
+    /// Whether the cell sizes vary
+    static bool stretched() { return _stretched; }
 
+    /**
+     * @brief Runs a loop with the stencils of the current grid
+     *
+     * The loop is called with std::true_type on stretched grids and with
+     * std::false_type otherwise, to be passed on as the template argument
+     * of the stencils. The grid type is thus checked once per loop instead
+     * of once per cell.
+     *
+     * @param[in] loop, called with the grid type
+     */
+    template <typename Loop> static void run(Loop &&loop) {
+        if (_stretched) {
+            loop(std::true_type{});
+        } else {
+            loop(std::false_type{});
+        }
+    }
 
   private:
     static double _dx;
     static double _dy;
     static double _gamma;
+
+    /// Set to true on stretched grids
+    static bool _stretched;
+    /// Column widths and row heights including the ghost cells, stretched grids only
+    static std::vector<double> _widths;
+    static std::vector<double> _heights;
 };
@@ -35,3 +35,28 @@ enum class cell_type {
     MOVING_WALL,
     DEFAULT
 };
+
+enum class field_type {
+    U,
+    V,
+    P,
+    T,
+};
+
+// Time integration of the explicit terms of the momentum and energy equations
+enum class time_scheme {
+    EULER,
+    AB2,
+};
+
+// Phases of a timestep, in the order they are executed in Case::simulate
+enum class step_phase {
+    BOUNDARY,
+    TEMPERATURE,
+    FLUXES,
+    RHS,
+    PRESSURE,
+    VELOCITIES,
+    OUTPUT,
+    COUNT
+};
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <array>
+
 #include "Datastructures.hpp"
 #include "Discretization.hpp"
 #include "Grid.hpp"
 
+class ImplicitDiffusion;
+
 /**
  * @brief Class of container and modifier for the physical fields
  *
@@ -47,6 +51,17 @@ class Fields {
     Fields(Grid &grid, double nu, double alpha, double beta, double dt, double tau, double UI,
            double VI, double PI, double TI, double GX, double GY);
 
+    /**
+     * @brief Constructor for fields of the same parameters on another grid
+     *
+     * All values are zero, the temperature is allocated if the given fields
+     * have one. The time integration is forward Euler with explicit diffusion.
+     *
+     * @param[in] fields the parameters are taken from
+     * @param[in] grid
+     */
+    Fields(const Fields &other, Grid &grid);
+
     /**
      * @brief Calculates the temperature based on explicit discretization of energy 
      * equations
@@ -123,13 +138,126 @@ class Fields {
     /// y-momentum flux index based access and modify
     double &g(int i, int j);
 
+    /// x-velocity index based access, zero outside of the stored tiles
+    double u(int i, int j) const;
+
+    /// y-velocity index based access, zero outside of the stored tiles
+    double v(int i, int j) const;
+
+    /// pressure index based access, zero outside of the stored tiles
+    double p(int i, int j) const;
+
+    /// temperature index based access, zero outside of the stored tiles
+    double t(int i, int j) const;
+
+    /**
+     * @brief Allocates the accumulators for the running statistics
+     *
+     * @param[in] grid in which the statistics are accumulated
+     * @param[in] energy equation flag
+     *
+     */
+    void enable_statistics(Grid &grid, bool energy_eq);
+
+    /**
+     * @brief Time-weighted update of the running mean and variance of U, V, P
+     * and T using the incremental algorithm of West
+     *
+     * @param[in] weight of the current state, i.e. the timestep size
+     *
+     */
+    void update_statistics(double weight);
+
+    /// whether the running statistics are accumulated
+    bool statistics_enabled() const;
+
+    /// accumulated time of the running statistics
+    double statistics_time() const;
+
+    /// time-averaged mean of the given field, index based access
+    double mean(field_type type, int i, int j) const;
+
+    /// root mean square of the fluctuations of the given field, index based access
+    double rms(field_type type, int i, int j) const;
+
     /// get timestep size
     double dt() const;
 
+    /// get thermal diffusivity
+    double alpha() const;
+
     /// pressure matrix access and modify
     Matrix<double> &p_matrix();
 
+    /// RHS matrix access and modify
+    Matrix<double> &rs_matrix();
+
+    /// x-velocity matrix access and modify
+    Matrix<double> &u_matrix();
+
+    /// y-velocity matrix access and modify
+    Matrix<double> &v_matrix();
+
+    /// temperature matrix access and modify
+    Matrix<double> &t_matrix();
+
+    /// pressure matrix access
+    const Matrix<double> &p_matrix() const;
+
+    /// x-velocity matrix access
+    const Matrix<double> &u_matrix() const;
+
+    /// y-velocity matrix access
+    const Matrix<double> &v_matrix() const;
+
+    /// temperature matrix access
+    const Matrix<double> &t_matrix() const;
+
+    /**
+     * @brief Treats the diffusion terms implicitly
+     *
+     * The explicit updates of the fluxes and temperatures are then turned
+     * into implicit ones by the given line solves, and the timestep size is
+     * no longer limited by the diffusion numbers but by the CFL condition
+     * and a maximum, which bounds the steps of a fluid at rest.
+     *
+     * @param[in] implicit diffusion solver, explicit diffusion if null
+     * @param[in] maximum timestep size with implicit diffusion
+     */
+    void set_diffusion(const ImplicitDiffusion *diffusion, double max_dt);
+
+    /**
+     * @brief Sets the time integration of the explicit terms
+     *
+     * With AB2, the explicit rates of change of F, G and T are extrapolated
+     * from the current and the previous timestep with the variable step
+     * Adams-Bashforth coefficients; the first step is a forward Euler step.
+     * The explicit diffusion limits are tau times the forward Euler bound
+     * nu dt (1/dx^2 + 1/dy^2) <= 1/2. The stability interval of AB2 on the
+     * negative real axis is half the one of forward Euler, so under AB2 tau
+     * is capped at ab2_diffusion_tau in the diffusion limits only. Up to
+     * this tau, AB2 takes the same timestep sizes as forward Euler, and the
+     * convective limits take the full tau.
+     *
+     * @param[in] time integration scheme
+     */
+    void set_time_scheme(time_scheme scheme);
+
   private:
+    /// Maximum absolute value of a matrix over the fluid cells
+    double max_abs(const Matrix<double> &A, Grid &grid) const;
+
+    /**
+     * @brief Replaces the forward Euler update of a field by the AB2 one
+     *
+     * @param[in] grid
+     * @param[in,out] forward Euler update
+     * @param[in] current values of the field
+     * @param[in,out] explicit rate of the previous step, replaced by the current one
+     */
+    void extrapolate_rate(Grid &grid, Matrix<double> &update, const Matrix<double> &current,
+                          Matrix<double> &rate) const;
+
     /// x-velocity matrix
     Matrix<double> _U;
     /// y-velocity matrix
@@ -145,6 +273,15 @@ class Fields {
     /// right hand side matrix
     Matrix<double> _RS;
 
+    /// running mean matrices of U, V, P and T
+    std::array<Matrix<double>, 4> _mean;
+    /// running sums of squared deviations of U, V, P and T
+    std::array<Matrix<double>, 4> _m2;
+    /// accumulated weight of the running statistics
+    double _statistics_weight{0.0};
+    /// number of fields with running statistics
+    int _num_statistics{0};
+
     /// kinematic viscosity
     double _nu;
     /// thermal diffusivity
@@ -159,4 +296,19 @@ class Fields {
     double _dt;
     /// adaptive timestep coefficient
     double _tau;
+    /// Largest safety factor of the diffusion limits under AB2, 80% of its stability bound, half the Euler one
+    static constexpr double ab2_diffusion_tau = 0.4;
+    /// implicit diffusion solver, null for explicit diffusion
+    const ImplicitDiffusion *_diffusion{nullptr};
+    /// maximum timestep size with implicit diffusion
+    double _max_dt{0.0};
+
+    /// time integration of the explicit terms
+    time_scheme _time_scheme{time_scheme::EULER};
+    /// explicit rates of change of U, V and T of the previous step, for AB2
+    Matrix<double> _rate_u;
+    Matrix<double> _rate_v;
+    Matrix<double> _rate_t;
+    /// timestep size of the stored rates, zero before the first step
+    double _rate_dt{0.0};
 };
@@ -10,6 +10,7 @@
 #include "Datastructures.hpp"
 #include "Domain.hpp"
 #include "Enums.hpp"
+#include "Parallel.hpp"
 
 /**
  * @brief Data structure holds cells and related sub-containers
@@ -31,6 +32,17 @@ class Grid {
      */
     Grid(std::string geom_name, Domain &domain);
 
+    /**
+     * @brief Constructor for a Grid of given geometrical data
+     *
+     * Geometry ids follow the ones of the .pgm files.
+     *
+     * @param[in] geometry ids, indexed [i][j] including the ghost cells
+     * @param[in] domain of the grid
+     *
+     */
+    Grid(std::vector<std::vector<int>> &geometry_data, Domain &domain);
+
     /// index based cell access
     Cell cell(int i, int j) const;
 
@@ -51,6 +63,145 @@ class Grid {
     /// access cell size in y-direction
     double dy() const;
 
+    /// access width of column i, ghost cells included
+    double dx(int i) const;
+    /// access height of row j, ghost cells included
+    double dy(int j) const;
+    /// distance between the centres of the columns i and i + 1
+    double dx_centres(int i) const { return 0.5 * (dx(i) + dx(i + 1)); }
+    /// distance between the centres of the rows j and j + 1
+    double dy_centres(int j) const { return 0.5 * (dy(j) + dy(j + 1)); }
+    /// x coordinate of the right face of column i, 0 at the left face of the first interior column
+    double x_face(int i) const;
+    /// y coordinate of the top face of row j, 0 at the bottom face of the first interior row
+    double y_face(int j) const;
+    /// smallest column width
+    double min_dx() const;
+    /// smallest row height
+    double min_dy() const;
+    /// whether the cell sizes vary
+    bool stretched() const { return _stretched; }
+
+    /**
+     * @brief Sets varying cell sizes
+     *
+     * The ghost cells take the size of their interior neighbours.
+     *
+     * @param[in] widths of the interior columns
+     * @param[in] heights of the interior rows
+     */
+    void set_spacing(const std::vector<double> &widths, const std::vector<double> &heights);
+
+    /**
+     * @brief Cell sizes of a stretched grid line
+     *
+     * Cells are clustered towards both ends of the line. With tanh, the faces
+     * are at L/2 (1 + tanh(p (2k/n - 1)) / tanh(p)); with geometric, the sizes
+     * grow by the factor p from both ends to the middle. Any other type gives
+     * uniform sizes.
+     *
+     * @param[in] type of the stretching, uniform, tanh or geometric
+     * @param[in] stretching parameter p
+     * @param[in] length of the line
+     * @param[in] number of cells
+     * @param[out] cell sizes
+     */
+    static std::vector<double> stretching(const std::string &type, double parameter, double length, int cells);
+
+    /**
+     * @brief Switches the fields of the grid to tiled storage
+     *
+     * The tiles which contain fluid cells or cells next to them, diagonals
+     * included, are active, so that the stencils of the fluid cells stay
+     * within the tile and its halo. The fluid cells are reordered tile by
+     * tile in the storage order, lexicographically within a tile.
+     */
+    void set_tiling();
+
+    /// access tile map of the fields, null for dense storage
+    const std::shared_ptr<const TileMap> &tiles() const { return _tiles; }
+
+    /**
+     * @brief Runs a loop over the fluid cells in parallel
+     *
+     * The body is called with DenseCells and ranges of the fluid cells for
+     * dense storage, split as by Parallel::parallel_for, and with the
+     * TileCells of each active tile and its fluid cells for tiled storage,
+     * the tiles being split among the threads. The body takes the element
+     * access of its matrices from access.
+     *
+     * @param[in] loop body, called with the cells, begin and end
+     */
+    template <typename Body> void for_fluid_cells(Body &&body) const {
+        if (!_tiles) {
+            Parallel::parallel_for(_fluid_cells.size(), [&](int begin, int end) { body(DenseCells{}, begin, end); });
+            return;
+        }
+        Parallel::parallel_for(
+            _tiles->active.size(),
+            [&](int begin, int end) {
+                for (int slot = begin; slot < end; ++slot) {
+                    body(TileCells{slot}, _tile_cells[slot], _tile_cells[slot + 1]);
+                }
+            },
+            1);
+    }
+
+    /**
+     * @brief Sum over the fluid cells in parallel
+     *
+     * @param[in] partial sum, called with the cells, begin and end as by for_fluid_cells
+     * @param[out] sum of the partial sums
+     */
+    template <typename Body> double sum_fluid_cells(Body &&body) const {
+        if (!_tiles) {
+            return Parallel::parallel_sum(_fluid_cells.size(),
+                                          [&](int begin, int end) { return body(DenseCells{}, begin, end); });
+        }
+        return Parallel::parallel_sum(_tiles->active.size(), [&](int begin, int end) {
+            double sum = 0.0;
+            for (int slot = begin; slot < end; ++slot) {
+                sum += body(TileCells{slot}, _tile_cells[slot], _tile_cells[slot + 1]);
+            }
+            return sum;
+        });
+    }
+
+    /**
+     * @brief Maximum over the fluid cells in parallel
+     *
+     * @param[in] maximum, called with the cells, begin and end as by for_fluid_cells
+     * @param[out] maximum of the maxima
+     */
+    template <typename Body> double max_fluid_cells(Body &&body) const {
+        if (!_tiles) {
+            return Parallel::parallel_max(_fluid_cells.size(),
+                                          [&](int begin, int end) { return body(DenseCells{}, begin, end); });
+        }
+        return Parallel::parallel_max(_tiles->active.size(), [&](int begin, int end) {
+            double max = 0.0;
+            for (int slot = begin; slot < end; ++slot) {
+                max = std::max(max, body(TileCells{slot}, _tile_cells[slot], _tile_cells[slot + 1]));
+            }
+            return max;
+        });
+    }
+
+    /**
+     * @brief Runs a loop over the fluid cells in their order on the calling thread
+     *
+     * @param[in] loop body, called with the cells, begin and end as by for_fluid_cells
+     */
+    template <typename Body> void sweep_fluid_cells(Body &&body) const {
+        if (!_tiles) {
+            body(DenseCells{}, 0, static_cast<int>(_fluid_cells.size()));
+            return;
+        }
+        for (std::size_t slot = 0; slot < _tiles->active.size(); ++slot) {
+            body(TileCells{static_cast<int>(slot)}, _tile_cells[slot], _tile_cells[slot + 1]);
+        }
+    }
+
     /**
      * @brief Access fluid cells
      *
@@ -135,4 +286,18 @@ class Grid {
 
     double _dx;
     double _dy;
+
+    /// Set to true if the cell sizes vary
+    bool _stretched{false};
+    /// Widths of the columns and heights of the rows, ghost cells included, empty if uniform
+    std::vector<double> _widths;
+    std::vector<double> _heights;
+    /// Coordinates of the right and top faces
+    std::vector<double> _x_faces;
+    std::vector<double> _y_faces;
+
+    /// Tile map of the fields, null for dense storage
+    std::shared_ptr<const TileMap> _tiles;
+    /// First fluid cell of the active tile in each slot, followed by the number of fluid cells
+    std::vector<int> _tile_cells;
 };
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vector>
+
+#include "Datastructures.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Coarse-to-fine initialisation of a run (grid sequencing)
+ *
+ * Before the run on the grid of the input file, the case is run on grids
+ * coarsened by 2^levels, ..., 4, 2 until it is approximately steady, and
+ * the result of every level is prolonged to the next finer one as its
+ * initial condition. The fine run then starts close to the steady state
+ * and skips most of the transient, which is cheap on the coarse grids.
+ *
+ * The geometry is coarsened conservatively: a coarse cell is an obstacle
+ * if any of the fine cells it covers is one, so that no obstacle is lost,
+ * and takes the most frequent id among them. Obstacle cells with more than
+ * two fluid neighbours, which the boundary conditions do not support, are
+ * turned into fluid cells.
+ */
+class GridSequence {
+  public:
+    GridSequence() = default;
+
+    /**
+     * @brief Constructor of the grid sequencing settings
+     *
+     * @param[in] number of coarse levels, disabled if not positive
+     * @param[in] tolerance of the relative change per unit time a level is run to
+     * @param[in] maximum simulation time of a level
+     * @param[in] SOR relaxation factor of the coarse levels
+     * @param[in] upwind differencing factor
+     */
+    GridSequence(int levels, double tolerance, double max_time, double omega, double gamma);
+
+    /**
+     * @brief Number of coarse levels usable on a grid
+     *
+     * Every coarse level has to divide the number of cells in each direction
+     * and keep at least min_cells of them.
+     *
+     * @param[in] fine grid
+     */
+    int levels(const Grid &grid) const;
+
+    double tolerance() const { return _tolerance; }
+    double max_time() const { return _max_time; }
+    double omega() const { return _omega; }
+    double gamma() const { return _gamma; }
+
+    /**
+     * @brief Geometry ids of the grid coarsened by the given factor
+     *
+     * @param[in] fine grid
+     * @param[in] coarsening factor
+     * @param[out] geometry ids indexed [i][j] including the ghost cells
+     */
+    static std::vector<std::vector<int>> coarsen(const Grid &grid, int factor);
+
+    /**
+     * @brief Restricts U, V, P and T to a coarser grid by averaging
+     *
+     * @param[in] fine grid
+     * @param[in] fine fields
+     * @param[in] coarse grid
+     * @param[out] coarse fields
+     */
+    static void restrict_fields(const Grid &fine_grid, Fields &fine, const Grid &coarse_grid, Fields &coarse);
+
+    /**
+     * @brief Prolongs U, V, P and T to a finer grid by bilinear interpolation
+     *
+     * Values at the fluid cells and at the faces next to them are replaced.
+     * Only coarse values at fluid cells, and for the velocities also the
+     * ones set by the boundary conditions next to them, are interpolated.
+     *
+     * @param[in] coarse grid
+     * @param[in] coarse fields
+     * @param[in] fine grid
+     * @param[in,out] fine fields
+     */
+    static void prolong(const Grid &coarse_grid, Fields &coarse, const Grid &fine_grid, Fields &fine);
+
+    /// Smallest number of cells of a coarse level in each direction
+    static const int min_cells = 4;
+
+  private:
+    int _levels{0};
+    double _tolerance{1e-3};
+    double _max_time{0.0};
+    double _omega{1.7};
+    double _gamma{0.5};
+};
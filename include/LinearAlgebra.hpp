@@ -0,0 +1,109 @@
+#pragma once
+
+#include <vector>
+
+/**
+ * @brief Direct solvers for the small systems of line relaxations
+ */
+namespace LinearAlgebra {
+
+/**
+ * @brief Solves a tridiagonal system with the Thomas algorithm
+ *
+ * Row k reads lower[k] x[k-1] + diag[k] x[k] + upper[k] x[k+1] = rhs[k],
+ * lower[0] and upper[n-1] are not used. The system must be diagonally
+ * dominant, no pivoting is done.
+ *
+ * @param[in] number of unknowns
+ * @param[in] subdiagonal
+ * @param[in] diagonal
+ * @param[in] superdiagonal
+ * @param[in,out] right hand side, overwritten by the solution
+ * @param[in] scratch space of n values
+ */
+void thomas(int n, const double *lower, const double *diag, const double *upper, double *rhs, double *scratch);
+
+/**
+ * @brief Factorized tridiagonal systems with constant off-diagonals
+ *
+ * Holds the Thomas elimination coefficients of many systems which share
+ * their sub- and superdiagonal coefficients but differ in their diagonals,
+ * e.g. in the rows modelling boundary conditions. Systems are factorized
+ * once, a solve is then a forward and a backward substitution.
+ */
+class TridiagonalSystems {
+  public:
+    TridiagonalSystems() = default;
+
+    /**
+     * @brief Constructor of an empty set of systems
+     *
+     * @param[in] subdiagonal coefficient
+     * @param[in] superdiagonal coefficient
+     */
+    TridiagonalSystems(double lower, double upper);
+
+    /**
+     * @brief Factorizes a system
+     *
+     * @param[in] diagonal of the system
+     * @param[out] offset of the system, to be passed to solve
+     */
+    int add(const std::vector<double> &diag);
+
+    /**
+     * @brief Solves a factorized system
+     *
+     * @param[in] offset of the system
+     * @param[in] number of unknowns of the system
+     * @param[in,out] right hand side, overwritten by the solution
+     */
+    void solve(int offset, int n, double *rhs) const;
+
+  private:
+    double _lower{0.0};
+    double _upper_coeff{0.0};
+    /// Eliminated superdiagonal of every row
+    std::vector<double> _upper;
+    /// Inverse of the eliminated diagonal of every row
+    std::vector<double> _inv_diag;
+};
+
+/**
+ * @brief Sparse matrix in compressed sparse row storage
+ *
+ * The entries of row i are val[row_ptr[i]] ... val[row_ptr[i + 1] - 1] in
+ * the columns col[row_ptr[i]] ..., ordered by column.
+ */
+struct CsrMatrix {
+    int rows{0};
+    int cols{0};
+    std::vector<int> row_ptr{0};
+    std::vector<int> col;
+    std::vector<double> val;
+
+    /// Number of stored entries
+    long nonzeros() const { return val.size(); }
+
+    /**
+     * @brief Matrix-vector product y = A x
+     *
+     * @param[in] vector of cols values
+     * @param[out] vector of rows values
+     */
+    void multiply(const double *x, double *y) const;
+
+    /// Transposed matrix
+    CsrMatrix transpose() const;
+
+    /**
+     * @brief Sparse matrix product
+     *
+     * @param[in] left factor
+     * @param[in] right factor
+     * @param[out] product a b
+     */
+    static CsrMatrix product(const CsrMatrix &a, const CsrMatrix &b);
+};
+
+} // namespace LinearAlgebra
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Point probe at a physical location of the domain
+ */
+struct Probe {
+    /// x coordinate of the probe
+    double x;
+    /// y coordinate of the probe
+    double y;
+};
+
+/**
+ * @brief Equidistant samples along a straight line of the domain
+ */
+struct LineSample {
+    /// x coordinate of the start point
+    double x0;
+    /// y coordinate of the start point
+    double y0;
+    /// x coordinate of the end point
+    double x1;
+    /// y coordinate of the end point
+    double y1;
+    /// Number of sample points, including both end points
+    int n;
+};
+
+/**
+ * @brief In-situ monitors evaluated during the simulation
+ *
+ * Holds the monitors declared in the input file (point probes, line samples,
+ * wall heat flux over the hot walls, kinetic energy and mass flux integrals)
+ * and streams their values as time series, either as CSV or as raw binary
+ * doubles. Scalar monitors and probes share a single file, every line sample
+ * gets its own file.
+ */
+class Monitor {
+  public:
+    Monitor() = default;
+
+    /**
+     * @brief Add a point probe
+     *
+     * @param[in] x coordinate of the probe
+     * @param[in] y coordinate of the probe
+     */
+    void add_probe(double x, double y);
+
+    /**
+     * @brief Add a line sample
+     *
+     * @param[in] x coordinate of the start point
+     * @param[in] y coordinate of the start point
+     * @param[in] x coordinate of the end point
+     * @param[in] y coordinate of the end point
+     * @param[in] number of sample points
+     */
+    void add_line(double x0, double y0, double x1, double y1, int n);
+
+    /**
+     * @brief Enable the heat flux integral over the hot fixed walls
+     *
+     * @param[in] hot wall temperature
+     * @param[in] reference temperature difference for the Nusselt number
+     */
+    void enable_heat_flux(double wall_temperature, double delta_temperature);
+
+    /// Enable the kinetic energy integral over the fluid cells
+    void enable_kinetic_energy();
+
+    /// Enable the mass flux integrals over the inflow and outflow cells
+    void enable_mass_flux();
+
+    /// Set the monitor evaluation frequency in timesteps
+    void set_frequency(int frequency);
+
+    /// Set the output format, either csv or binary
+    void set_format(const std::string &format);
+
+    /// Whether any monitor is declared
+    bool active() const;
+
+    /// Whether the monitors are evaluated at the given timestep
+    bool due(int step) const;
+
+    /**
+     * @brief Open the time series files
+     *
+     * @param[in] output file name prefix including directory and case name
+     * @param[in] energy equation flag
+     */
+    void open(const std::string &prefix, bool energy_eq);
+
+    /**
+     * @brief Evaluate all monitors and append a record to the time series
+     *
+     * @param[in] field to be sampled
+     * @param[in] grid in which the field is defined
+     * @param[in] simulation time
+     */
+    void evaluate(const Fields &field, Grid &grid, double t);
+
+    /// Flush and close the time series files
+    void close();
+
+  private:
+    /// Cell centered values of u, v, p (and T) in the cell containing (x, y)
+    void sample(const Fields &field, Grid &grid, double x, double y, std::vector<double> &record) const;
+    /// Heat flux from the hot walls into the fluid
+    double wall_heat_flux(const Fields &field, Grid &grid) const;
+    /// Kinetic energy of the fluid
+    double kinetic_energy(const Fields &field, Grid &grid) const;
+    /// Volume flux through the inflow cells
+    double inflow_mass_flux(const Fields &field, Grid &grid) const;
+    /// Volume flux through the outflow cells
+    double outflow_mass_flux(const Fields &field, Grid &grid) const;
+    /// Open a time series file and write its header
+    std::unique_ptr<std::ofstream> open_series(const std::string &name, const std::vector<std::string> &columns);
+    /// Append a record to a time series file
+    void write_record(std::ofstream &file, const std::vector<double> &record) const;
+
+    std::vector<Probe> _probes;
+    std::vector<LineSample> _lines;
+
+    bool _heat_flux{false};
+    bool _kinetic_energy{false};
+    bool _mass_flux{false};
+    bool _energy_eq{false};
+    bool _binary{false};
+
+    /// Hot wall temperature
+    double _wall_temperature{0.0};
+    /// Reference temperature difference
+    double _delta_temperature{1.0};
+    /// Evaluation frequency in timesteps
+    int _frequency{1};
+
+    /// Time series of scalar monitors and probes
+    std::unique_ptr<std::ofstream> _scalar_file;
+    /// Time series of each line sample
+    std::vector<std::unique_ptr<std::ofstream>> _line_files;
+    /// Record buffer reused between evaluations
+    std::vector<double> _record;
+};
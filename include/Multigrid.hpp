@@ -0,0 +1,103 @@
+#pragma once
+
+#include <ostream>
+#include <vector>
+
+#include "LinearAlgebra.hpp"
+
+/**
+ * @brief Smoothed aggregation algebraic multigrid
+ *
+ * The hierarchy is built from the matrix alone, so that it follows the
+ * fluid-cell graph of arbitrary geometries. On every level, the unknowns are
+ * grouped into aggregates of strongly coupled neighbours, the tentative
+ * piecewise constant prolongation is smoothed by a damped Jacobi step,
+ *
+ *     P = (I - omega D^-1 A) T,   omega = 4 / (3 rho(D^-1 A)),
+ *
+ * and the coarse operator is the Galerkin product P^T A P. The coarsest
+ * level is solved with a dense Cholesky factorization.
+ *
+ * A V-cycle with one forward Gauss-Seidel sweep before and one backward
+ * sweep after the coarse correction is a symmetric operator and can
+ * precondition the conjugate gradient method. The matrix must be symmetric
+ * positive (semi-)definite. Null space directions, such as the constants of
+ * regions with pure Neumann boundaries, show up as zero pivots of the
+ * coarsest factorization, and their unknowns are set to zero.
+ */
+class AlgebraicMultigrid {
+  public:
+    /// Maximum number of unknowns of the coarsest level
+    static constexpr int max_coarse_size = 200;
+    /// Relative coupling strength below which neighbours are not aggregated
+    static constexpr double strength_threshold = 0.08;
+    /// Pivots below this fraction of the diagonal entry are taken as zero
+    static constexpr double null_pivot_tolerance = 1e-10;
+
+    AlgebraicMultigrid() = default;
+
+    /**
+     * @brief Builds the hierarchy
+     *
+     * @param[in] symmetric positive (semi-)definite matrix
+     */
+    explicit AlgebraicMultigrid(LinearAlgebra::CsrMatrix matrix);
+
+    /**
+     * @brief Applies a V-cycle to the system A x = b, starting from x = 0
+     *
+     * @param[in] right hand side
+     * @param[out] approximate solution
+     */
+    void apply(const double *b, double *x) const;
+
+    /// Matrix of the finest level
+    const LinearAlgebra::CsrMatrix &matrix() const { return _levels.front().A; }
+
+    /// Number of levels including the finest one
+    int num_levels() const { return _levels.size(); }
+
+    /**
+     * @brief Prints the sizes of the levels and the operator complexity
+     *
+     * @param[in] output stream
+     */
+    void report(std::ostream &out) const;
+
+  private:
+    struct Level {
+        LinearAlgebra::CsrMatrix A;
+        /// Prolongation from the next coarser level and its transpose
+        LinearAlgebra::CsrMatrix P;
+        LinearAlgebra::CsrMatrix R;
+        std::vector<double> inv_diag;
+        /// Scratch vectors of the cycle
+        mutable std::vector<double> x;
+        mutable std::vector<double> b;
+        mutable std::vector<double> r;
+    };
+
+    /**
+     * @brief Groups the unknowns into aggregates of strongly coupled neighbours
+     *
+     * @param[in] matrix of the level
+     * @param[out] aggregate of every unknown
+     * @param[out] number of aggregates
+     */
+    static int aggregate(const LinearAlgebra::CsrMatrix &A, std::vector<int> &aggregates);
+
+    /// Cycle on a level, x is overwritten
+    void cycle(int level, const double *b, double *x) const;
+
+    /// Factorizes the dense coarsest matrix
+    void factorize_coarse();
+
+    /// Solves the coarsest level
+    void solve_coarse(const double *b, double *x) const;
+
+    std::vector<Level> _levels;
+    /// Lower triangular Cholesky factor of the coarsest matrix, row major
+    std::vector<double> _cholesky;
+    /// Unknowns of the coarsest level depending on the previous ones
+    std::vector<bool> _null_pivot;
+};
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Selection of the fields and of the cell window written to a
+ * solution file
+ *
+ * The window is given in interior cell indices, both ends included.
+ * Non-positive upper bounds select the whole domain.
+ */
+struct OutputSettings {
+    /// Write the pressure field
+    bool pressure{true};
+    /// Write the velocity field
+    bool velocity{true};
+    /// Write the temperature field, if the energy equation is enabled
+    bool temperature{true};
+
+    /// First written cell in x direction
+    int imin{1};
+    /// Last written cell in x direction
+    int imax{-1};
+    /// First written cell in y direction
+    int jmin{1};
+    /// Last written cell in y direction
+    int jmax{-1};
+
+    /// Only every stride-th cell is written in each direction
+    int stride{1};
+
+    /**
+     * @brief Selects the written fields from a comma separated list
+     *
+     * @param[in] list of pressure, velocity and temperature
+     */
+    void select_fields(const std::string &fields);
+
+    /// Whether the settings write all fields over the whole domain
+    bool full() const;
+};
+
+/**
+ * @brief Named data array of a snapshot, component-interleaved like a
+ * vtkDataArray
+ */
+struct SnapshotArray {
+    /// Array name
+    std::string name;
+    /// Number of components per tuple
+    int num_components{1};
+    /// Point data if true, cell data otherwise
+    bool point_data{false};
+    /// Tuple values, ordered from bottom to top
+    std::vector<double> values;
+};
+
+/**
+ * @brief Solution data of an output file, independent of the file format
+ *
+ * The written cells span the cell corners given by the x and y coordinates.
+ */
+struct Snapshot {
+    /// x coordinates of the cell corners
+    std::vector<double> x;
+    /// y coordinates of the cell corners
+    std::vector<double> y;
+    /// Ids of the blanked (obstacle) cells
+    std::vector<int> blanked;
+    /// Written as rectilinear grid, given by the coordinates only, if true
+    bool rectilinear{false};
+    /// Cell and point data
+    std::vector<SnapshotArray> arrays;
+
+    /// Number of written cells in x direction
+    int cells_x() const { return x.size() - 1; }
+    /// Number of written cells in y direction
+    int cells_y() const { return y.size() - 1; }
+};
+
+/**
+ * @brief Static methods to write the solution to .vtk files
+ *
+ */
+class VTKOutput {
+  public:
+    /**
+     * @brief Solution file outputter
+     *
+     * Ghost cells are excluded. Pressure and temperature are cell variables
+     * while velocity is a point variable interpolated to the cell corners.
+     * With a stride larger than one, each written cell carries the values of
+     * the lower left cell of the block it represents.
+     *
+     * @param[in] output file name
+     * @param[in] grid of the solution
+     * @param[in] fields of the solution
+     * @param[in] field and window selection
+     * @param[in] energy equation flag
+     */
+    static void write(const std::string &file_name, Grid &grid, const Fields &field, const OutputSettings &settings,
+                      bool energy_eq);
+
+    /**
+     * @brief Collects the data of a solution file
+     *
+     * @param[in] grid of the solution
+     * @param[in] fields of the solution
+     * @param[in] field and window selection
+     * @param[in] energy equation flag
+     * @param[out] snapshot of the selected fields
+     */
+    static Snapshot snapshot(Grid &grid, const Fields &field, const OutputSettings &settings, bool energy_eq);
+
+    /**
+     * @brief Writes a snapshot as structured grid to a .vtk file
+     *
+     * Snapshots of stretched grids are written as rectilinear grid, which
+     * stores the coordinates of the grid lines instead of every point.
+     *
+     * @param[in] output file name
+     * @param[in] snapshot to be written
+     */
+    static void write(const std::string &file_name, const Snapshot &snapshot);
+
+    /**
+     * @brief Running statistics file outputter
+     *
+     * Outputs the time-averaged mean and the RMS of the fluctuations of
+     * pressure, velocity and temperature over the whole domain.
+     *
+     * @param[in] output file name
+     * @param[in] grid of the solution
+     * @param[in] fields holding the running statistics
+     * @param[in] energy equation flag
+     */
+    static void write_statistics(const std::string &file_name, Grid &grid, const Fields &field, bool energy_eq);
+
+  private:
+    /// Matrix indices of the written cell corners in one direction
+    static std::vector<int> corner_indices(int min, int max, int stride);
+
+    /// Corner coordinates and blanked obstacle cells of the given cell corners
+    static Snapshot create_snapshot(Grid &grid, const std::vector<int> &corners_x, const std::vector<int> &corners_y);
+};
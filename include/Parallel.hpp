@@ -0,0 +1,137 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Persistent pool of worker threads
+ *
+ * The workers are started once and wait for tasks, so that running a loop
+ * in parallel costs a wake-up instead of a thread creation. A task is run
+ * once on every thread of the pool, the calling thread taking id 0.
+ */
+class ThreadPool {
+  public:
+    /**
+     * @brief Starts the workers of the pool
+     *
+     * @param[in] number of threads including the calling thread
+     */
+    explicit ThreadPool(int num_threads);
+
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// Number of threads including the calling thread
+    int size() const;
+
+    /**
+     * @brief Runs a task on all threads and waits for its completion
+     *
+     * @param[in] task, called with the thread id
+     */
+    void run(const std::function<void(int)> &task);
+
+  private:
+    void work(int id);
+
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _start;
+    std::condition_variable _done;
+    const std::function<void(int)> *_task{nullptr};
+    uint64_t _generation{0};
+    int _pending{0};
+    bool _stop{false};
+};
+
+/**
+ * @brief Shared-memory parallelisation of the loops over cells
+ *
+ * Loops are split into contiguous chunks, one per thread. With a single
+ * thread the loop body is called once for the whole range, so results are
+ * identical to the serial loops. Sums are accumulated per chunk and combined
+ * in chunk order, they therefore depend on the number of threads only.
+ */
+namespace Parallel {
+
+/// Sets the number of threads used by the parallel loops
+void set_num_threads(int num_threads);
+
+/// Number of threads used by the parallel loops
+int num_threads();
+
+/// Chunks smaller than this are not worth a thread
+constexpr int min_chunk_size = 256;
+
+/// Number of chunks a loop of n iterations is split into
+int num_chunks(int n, int min_chunk = min_chunk_size);
+
+/// Runs the chunks of a loop on the pool, chunk c covering [c * n / chunks, (c + 1) * n / chunks)
+void run_chunks(int n, int chunks, const std::function<void(int, int, int)> &body);
+
+/**
+ * @brief Runs a loop over [0, n) in parallel
+ *
+ * A loop that is not split is called directly, without going through the pool.
+ *
+ * @param[in] number of iterations
+ * @param[in] loop body, called with the begin and end of a chunk
+ * @param[in] minimum number of iterations of a chunk, larger for expensive iterations
+ */
+template <typename Body> void parallel_for(int n, Body &&body, int min_chunk = min_chunk_size) {
+    int chunks = num_chunks(n, min_chunk);
+    if (chunks == 1) {
+        body(0, n);
+        return;
+    }
+    run_chunks(n, chunks, [&](int, int begin, int end) { body(begin, end); });
+}
+
+/**
+ * @brief Sum over [0, n) in parallel
+ *
+ * @param[in] number of iterations
+ * @param[in] partial sum of a chunk, called with its begin and end
+ * @param[out] sum of the partial sums
+ */
+template <typename Body> double parallel_sum(int n, Body &&body) {
+    int chunks = num_chunks(n);
+    if (chunks == 1) {
+        return body(0, n);
+    }
+    std::vector<double> partial(chunks, 0.0);
+    run_chunks(n, chunks, [&](int c, int begin, int end) { partial[c] = body(begin, end); });
+
+    double sum = 0.0;
+    for (double value : partial) {
+        sum += value;
+    }
+    return sum;
+}
+
+/**
+ * @brief Maximum over [0, n) in parallel
+ *
+ * @param[in] number of iterations
+ * @param[in] maximum of a chunk, called with its begin and end
+ * @param[out] maximum of the chunk maxima
+ */
+template <typename Body> double parallel_max(int n, Body &&body) {
+    int chunks = num_chunks(n);
+    if (chunks == 1) {
+        return body(0, n);
+    }
+    std::vector<double> partial(chunks, 0.0);
+    run_chunks(n, chunks, [&](int c, int begin, int end) { partial[c] = body(begin, end); });
+    return *std::max_element(partial.begin(), partial.end());
+}
+
+} // namespace Parallel
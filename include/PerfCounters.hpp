@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "StepLog.hpp"
+
+/// Hardware events counted per phase
+enum class perf_event {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    VECTOR, // Optional raw event counting vector instructions
+    COUNT
+};
+
+/// Number of counted hardware events
+constexpr int num_perf_events = static_cast<int>(perf_event::COUNT);
+
+/**
+ * @brief Hardware performance counters of the phases of a timestep
+ *
+ * Counts cycles, retired instructions, L1 data cache read misses and last
+ * level cache read misses with Linux perf_event_open, scoped to the same
+ * phases as the PhaseTimer. Each thread of the pool opens its own
+ * counters, which are summed, so the pool has to be set up before open. Vector instructions are
+ * counted by an optional model specific raw event, e.g. 0x20010c7 for the
+ * packed double precision FP_ARITH_INST_RETIRED events on recent Intel cores.
+ *
+ * Counters which cannot be opened (missing hardware support, restrictive
+ * perf_event_paranoid settings, virtual machines) are skipped and reported
+ * as unavailable.
+ */
+class PerfCounters {
+  public:
+    PerfCounters() = default;
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    /**
+     * @brief Opens and enables the counters of all threads of the pool
+     *
+     * @param[in] raw event config of the vector instruction counter, not counted if zero
+     * @param[out] whether at least one counter could be opened
+     */
+    bool open(uint64_t vector_event = 0);
+
+    /// Whether at least one counter is open
+    bool is_open() const;
+
+    /// Starts counting the given phase
+    void start(step_phase phase);
+
+    /// Stops counting the given phase and accumulates the counts
+    void stop(step_phase phase);
+
+    /**
+     * @brief Prints the per-phase counts
+     *
+     * Reports instructions per cycle, cache misses per cell, the memory
+     * traffic per cell estimated from the last level cache misses and the
+     * resulting bandwidth, and the vector instruction fraction.
+     *
+     * @param[in] output stream
+     * @param[in] accumulated wall clock time of each phase in seconds
+     * @param[in] number of fluid cells
+     * @param[in] number of timesteps
+     */
+    void report(std::ostream &out, const std::array<double, num_step_phases> &phase_time, long cells,
+                int steps) const;
+
+  private:
+    /// Reads the current, multiplexing corrected values of the open counters
+    void read(std::array<double, num_perf_events> &values) const;
+
+    /// Counters of every thread per event, empty if the event is unavailable
+    std::array<std::vector<int>, num_perf_events> _fd;
+    std::array<std::array<double, num_perf_events>, num_step_phases> _start{};
+    std::array<std::array<double, num_perf_events>, num_step_phases> _total{};
+};
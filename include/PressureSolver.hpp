@@ -3,7 +3,76 @@
 #include "Boundary.hpp"
 #include "Fields.hpp"
 #include "Grid.hpp"
+#include "LinearAlgebra.hpp"
+#include "Multigrid.hpp"
+#include <array>
+#include <atomic>
+#include <memory>
 #include <utility>
+/**
+ * @brief Homogeneous part of the pressure boundary conditions
+ *
+ * Models the pressure boundary conditions set by Boundary::apply_pressure
+ * from the cell types, for corrections and error vectors which satisfy
+ * their homogeneous version: outflow cells are Dirichlet cells holding the
+ * negated value of their fluid neighbour, all other boundary cells hold the
+ * mean of their one or two fluid neighbours. Values are addressed by the
+ * linear index i + imaxb * j of the cells.
+ */
+class HomogeneousPressureBoundary {
+  public:
+    HomogeneousPressureBoundary() = default;
+
+    /**
+     * @brief Finds the boundary cells next to the fluid cells of a grid
+     *
+     * @param[in] grid to be used
+     */
+    explicit HomogeneousPressureBoundary(const Grid &grid);
+
+    /**
+     * @brief Sets the boundary values from the fluid values
+     *
+     * @param[in,out] values of all cells
+     */
+    template <typename T> void apply(T *values) const {
+        for (const auto &b : _stencils) {
+            values[b.cell] = static_cast<T>(b.weight) * (values[b.first] + (b.second >= 0 ? values[b.second] : T(0)));
+        }
+    }
+
+    /**
+     * @brief Adds boundary values to the pressure
+     *
+     * @param[in] field to be updated
+     * @param[in] correction of all cells
+     * @param[in] number of cells in x direction including ghost cells
+     */
+    template <typename T> void add_to_pressure(Fields &field, const T *values, int stride) const {
+        for (const auto &b : _stencils) {
+            field.p(b.cell % stride, b.cell / stride) += values[b.cell];
+        }
+    }
+
+    /// Whether there are Dirichlet cells, otherwise the constant is in the null space
+    bool dirichlet() const { return _dirichlet; }
+
+    /// Boundary cell whose value is weight times the sum of the values of one or two cells, -1 if unused
+    struct Stencil {
+        int cell;
+        int first;
+        int second;
+        float weight;
+    };
+
+    /// Stencils of all boundary cells next to fluid cells
+    const std::vector<Stencil> &stencils() const { return _stencils; }
+
+  private:
+    std::vector<Stencil> _stencils;
+    bool _dirichlet{false};
+};
+
 /**
  * @brief Abstract class for pressure Poisson equation solver
  *
@@ -21,6 +90,34 @@ class PressureSolver {
      * @param[in] boundary to be used
      */
     virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) = 0;
+
+    /**
+     * @brief Prepares the solves of a timestep, called before its first solve
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    virtual void initialize(Fields &field, Grid &grid) {}
+
+    /**
+     * @brief Sets the relaxation factor of the following iterations
+     *
+     * Solvers without a relaxation factor ignore it.
+     *
+     * @param[in] relaxation factor
+     */
+    virtual void set_omega(double omega) {}
+
+    /// Number of relaxation sweeps of a solve call
+    virtual int sweeps_per_solve() const { return 1; }
+
+    /**
+     * @brief Root mean square of the pressure equation residual over the fluid cells
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    static double residual(Fields &field, Grid &grid);
 };
 
 /**
@@ -50,6 +147,485 @@ class SOR : public PressureSolver {
      */
     virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
 
+    /**
+     * @brief Single SOR sweep over the fluid cells, without residual evaluation
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    void sweep(Fields &field, Grid &grid);
+
+    /// Sets the relaxation factor of the following sweeps
+    virtual void set_omega(double omega) { _omega = omega; }
+
+    /// Current relaxation factor
+    double omega() const { return _omega; }
+
   private:
     double _omega;
 };
+
+/**
+ * @brief Line Successive Over-Relaxation for solution of pressure Poisson
+ * equation
+ *
+ * Every contiguous run of fluid cells along a grid line is solved exactly
+ * with the Thomas algorithm, the neighbouring lines being taken from the
+ * current iterate. The boundary cells at both ends of a run follow the
+ * boundary conditions as modelled by HomogeneousPressureBoundary, their
+ * dependence on the end cells is folded into the end rows of the system
+ * and the remainder, e.g. twice the outlet pressure, moved to the right
+ * hand side. The lines run in the
+ * direction of the smaller cell size, i.e. of the stronger coupling, which
+ * point SOR resolves slowly for cells of large aspect ratio. Lines are
+ * relaxed in zebra order, first the even then the odd ones, so that the
+ * lines of a colour are independent and are relaxed in parallel.
+ */
+class LineSOR : public PressureSolver {
+  public:
+    /**
+     * @brief Constructor of line SOR solver
+     *
+     * @param[in] relaxation factor
+     */
+    LineSOR(double omega);
+
+    virtual ~LineSOR() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Single zebra line sweep over the fluid cells, without residual evaluation
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    void sweep(Fields &field, Grid &grid);
+
+    /// Sets the relaxation factor of the following sweeps
+    virtual void set_omega(double omega) { _omega = omega; }
+
+    /// Current relaxation factor
+    double omega() const { return _omega; }
+
+  private:
+    /// Fluid cells [begin, end) of a grid line
+    struct Segment {
+        int line;
+        int begin;
+        int end;
+        /// Offset of the factorized system
+        int system;
+        /// Boundary cells before the first and after the last cell
+        int ends[2];
+    };
+
+    /// Boundary cell at the end of a segment, holding self * P(fluid) + weight * P(other) + constant
+    struct End {
+        int cell;
+        int fluid;
+        int other;
+        double self;
+        double weight;
+    };
+
+    /// Finds the fluid segments of the lines and factorizes their systems
+    void setup(const Grid &grid);
+
+    double _omega;
+    /// Grid the segments were set up for
+    const Grid *_grid{nullptr};
+    /// Set to true if the lines run in x direction
+    bool _x_lines{true};
+    /// Segments of the even and of the odd lines
+    std::array<std::vector<Segment>, 2> _segments;
+    /// Boundary cells at the segment ends, addressed by the linear index i + imaxb * j
+    std::vector<End> _ends;
+    /// Constant parts of the end values of the current sweep
+    std::vector<double> _end_constants;
+    /// End values of the current colour, except for the parts folded into the systems
+    std::vector<double> _end_values;
+    LinearAlgebra::TridiagonalSystems _systems;
+    /// Minimum number of segments relaxed by a thread
+    int _min_chunk{1};
+};
+
+/**
+ * @brief Mixed-precision SOR for solution of pressure Poisson equation
+ *
+ * Iterative refinement around single-precision SOR sweeps: every solve call
+ * evaluates the residual r = RS - laplacian(P) in double precision, relaxes
+ * the correction equation laplacian(E) = r with a number of lexicographic
+ * SOR sweeps on float copies of E and r, and adds E to P. The returned
+ * residual is the true double-precision one, so the solution meets the
+ * tolerance as with SOR, while the sweeps move half the bytes.
+ *
+ * The correction carries the homogeneous part of the pressure boundary
+ * conditions as modelled by HomogeneousPressureBoundary. A boundary
+ * condition deviating from the model only slows down the refinement, the
+ * outer residual uses the true one.
+ */
+class MixedPrecisionSOR : public PressureSolver {
+  public:
+    /**
+     * @brief Constructor of mixed-precision SOR solver
+     *
+     * @param[in] relaxation factor
+     * @param[in] number of single-precision sweeps per solve call
+     */
+    MixedPrecisionSOR(double omega, int inner_sweeps);
+
+    virtual ~MixedPrecisionSOR() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /// Sets the relaxation factor of the following sweeps
+    virtual void set_omega(double omega) { _omega = omega; }
+
+    /// Number of single-precision sweeps of a solve call
+    virtual int sweeps_per_solve() const { return _inner_sweeps; }
+
+  private:
+    /// Sets up the cell indices and the boundary model
+    void setup(const Grid &grid);
+
+    double _omega;
+    int _inner_sweeps;
+    /// Grid the indices were set up for
+    const Grid *_grid{nullptr};
+    /// Number of cells in x direction including ghost cells, the stride of the arrays
+    int _stride{0};
+    /// Linear indices of the fluid cells in sweep order
+    std::vector<int> _fluid;
+    HomogeneousPressureBoundary _boundary;
+    /// Correction and residual of all cells
+    std::vector<float> _correction;
+    std::vector<float> _residual;
+};
+
+/**
+ * @brief Temporally blocked SOR for solution of pressure Poisson equation
+ *
+ * Every solve call applies a number of lexicographic SOR sweeps. Instead of
+ * streaming the whole pressure matrix once per sweep, the rows are processed
+ * in tiles sized for the L2 cache, and each tile is relaxed by all sweeps
+ * before the next one is loaded: sweep s trails sweep s - 1 by two rows
+ * (wavefront skew). One row is needed since the upper neighbours of a row
+ * must hold the values of the previous sweep, the second one to refresh the
+ * boundary values of the row above from the previous sweep just before they
+ * are first read, as Boundary::apply_pressure would before every sweep. The
+ * boundary values follow HomogeneousPressureBoundary, plus the constant
+ * offset of each boundary cell found at the start of the call. Every cell
+ * thus sees the same values as in consecutive full sweeps with the boundary
+ * conditions applied in between, and the result is bitwise identical to
+ * them up to the rounding of nonzero offsets, e.g. of the outlet pressure.
+ */
+class BlockedSOR : public PressureSolver {
+  public:
+    /// Cache size the tiles are sized for, in bytes
+    static constexpr long tile_cache_bytes = 512 * 1024;
+
+    /**
+     * @brief Constructor of temporally blocked SOR solver
+     *
+     * @param[in] relaxation factor
+     * @param[in] number of sweeps per solve call
+     */
+    BlockedSOR(double omega, int sweeps);
+
+    virtual ~BlockedSOR() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Applies the sweeps of a solve call, without residual evaluation
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    void sweep(Fields &field, Grid &grid);
+
+    /// Sets the relaxation factor of the following sweeps
+    virtual void set_omega(double omega) { _omega = omega; }
+
+    /// Number of sweeps of a solve call
+    virtual int sweeps_per_solve() const { return _sweeps; }
+
+    /// Number of rows of a tile
+    int tile_rows() const { return _tile_rows; }
+
+  private:
+    /// Fluid cells [begin, end) of a row, as linear indices
+    struct Segment {
+        int begin;
+        int end;
+    };
+
+    /// Finds the fluid segments of the rows and sizes the tiles
+    void setup(const Grid &grid);
+
+    double _omega;
+    int _sweeps;
+    /// Grid the segments were set up for
+    const Grid *_grid{nullptr};
+    int _stride{0};
+    int _tile_rows{1};
+    /// Segments of row j are _segments[_row_begin[j]] ... _segments[_row_begin[j + 1] - 1]
+    std::vector<Segment> _segments;
+    std::vector<int> _row_begin;
+    /// Boundary stencils of row j are _stencils[_stencil_begin[j]] ... _stencils[_stencil_begin[j + 1] - 1]
+    std::vector<HomogeneousPressureBoundary::Stencil> _stencils;
+    std::vector<int> _stencil_begin;
+    /// Constant part of the boundary value of every stencil
+    std::vector<double> _offsets;
+};
+
+/**
+ * @brief Lexicographic SOR sweeping on several threads for solution of
+ * pressure Poisson equation
+ *
+ * The interior columns are split into one block per thread, and the threads
+ * sweep their blocks row by row in a pipeline: a thread relaxes its block of
+ * row j once the thread to its left has finished row j, so the left
+ * neighbour of its first cell holds the new value. The right neighbour of
+ * its last cell and the upper neighbours are only relaxed later, exactly as
+ * in the serial sweep. Every cell is therefore relaxed with the same values
+ * and the same arithmetic as in SOR::sweep, and the result is bitwise
+ * identical to SOR for any number of threads. The threads start one row
+ * apart, and wait for each other only at the block edges of every row.
+ */
+class WavefrontSOR : public PressureSolver {
+  public:
+    /// Minimum number of columns of a thread block
+    static constexpr int min_block_columns = 32;
+
+    /**
+     * @brief Constructor of wavefront-parallel SOR solver
+     *
+     * @param[in] relaxation factor
+     */
+    WavefrontSOR(double omega);
+
+    virtual ~WavefrontSOR() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Single SOR sweep over the fluid cells, without residual evaluation
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    void sweep(Fields &field, Grid &grid);
+
+    /// Sets the relaxation factor of the following sweeps
+    virtual void set_omega(double omega) { _omega = omega; }
+
+    /// Number of column blocks, i.e. of threads sweeping concurrently
+    int num_blocks() const { return _num_blocks; }
+
+  private:
+    /// Rows finished by the thread of a block, padded to a cache line against false sharing
+    struct alignas(64) Progress {
+        std::atomic<int> rows{0};
+    };
+
+    /// Splits the fluid cells of every row into the column blocks
+    void setup(const Grid &grid);
+
+    double _omega;
+    /// Grid and number of threads the blocks were set up for
+    const Grid *_grid{nullptr};
+    int _num_threads{0};
+    int _num_blocks{1};
+    int _num_rows{0};
+    /// Fluid cells of row j and block b are _cells[_block_begin[j * _num_blocks + b]] ... up to the next entry
+    std::vector<int> _cells;
+    std::vector<int> _block_begin;
+    std::unique_ptr<Progress[]> _progress;
+};
+
+/**
+ * @brief Chebyshev-accelerated Jacobi iteration for solution of pressure
+ * Poisson equation
+ *
+ * Every iteration computes the Jacobi update from the current pressure and
+ * combines it with the previous iterate,
+ *
+ *     P_new = P_old + w_k (jacobi(P) - P_old),
+ *
+ * with the Chebyshev weights w_1 = 1, w_2 = 1 / (1 - mu^2 / 2) and
+ * w_(k+1) = 1 / (1 - mu^2 w_k / 4) for the spectral radius mu of the
+ * Jacobi iteration. The update reads P and writes the buffer of P_old,
+ * which then becomes P, so the cells are independent: the rows of fluid
+ * cells are distributed over the threads and their inner loops vectorise.
+ * The weights restart at every timestep.
+ *
+ * mu is estimated once from power iterations of the Jacobi iteration with
+ * homogeneous boundary conditions, started from a smooth ramp over the
+ * domain, which is close to the slowest modes.
+ */
+class ChebyshevJacobi : public PressureSolver {
+  public:
+    /// Number of power iterations of the spectral radius estimate
+    static constexpr int power_iterations = 20;
+
+    ChebyshevJacobi() = default;
+
+    virtual ~ChebyshevJacobi() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Restarts the Chebyshev weights with the current pressure
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    virtual void initialize(Fields &field, Grid &grid);
+
+    /// Estimated spectral radius of the Jacobi iteration
+    double jacobi_radius() const { return _mu; }
+
+  private:
+    /// Fluid cells [begin, end) of the row j, as linear indices
+    struct Row {
+        int begin;
+        int end;
+    };
+
+    /// Finds the fluid rows and estimates the spectral radius
+    void setup(const Grid &grid);
+
+    /// Power iteration estimate of the Jacobi spectral radius
+    double estimate_radius(const Grid &grid) const;
+
+    /// Grid the rows were set up for
+    const Grid *_grid{nullptr};
+    /// Number of cells in x direction including ghost cells
+    int _stride{0};
+    std::vector<Row> _rows;
+    /// Minimum number of rows updated by a thread
+    int _min_chunk{1};
+    HomogeneousPressureBoundary _boundary;
+    /// Previous iterate, overwritten by the next one
+    Matrix<double> _previous;
+    double _mu{0.0};
+    double _weight{1.0};
+    int _iteration{0};
+};
+
+/**
+ * @brief Algebraic multigrid for solution of pressure Poisson equation
+ *
+ * The negated Laplacian over the fluid cells, with the pressure boundary
+ * conditions as modelled by HomogeneousPressureBoundary, is assembled once
+ * from the fluid-cell graph of the grid, and the smoothed aggregation
+ * hierarchy built from it is kept for the whole run. Corner couplings of
+ * cells with different dx and dy are symmetrized.
+ *
+ * As standalone solver, every solve call is a V-cycle on the correction
+ * equation of the current double-precision residual. As preconditioner,
+ * every solve call is an iteration of the preconditioned conjugate gradient
+ * method, started at every timestep from the current residual and restarted
+ * from it when the residual of the assembled model drops well below the
+ * true one.
+ */
+class AMGSolver : public PressureSolver {
+  public:
+    /**
+     * @brief Assembles the matrix of a grid and builds the hierarchy
+     *
+     * @param[in] grid to be used
+     * @param[in] whether to precondition the conjugate gradient method instead of cycling
+     */
+    AMGSolver(const Grid &grid, bool pcg);
+
+    virtual ~AMGSolver() = default;
+
+    /**
+     * @brief Solve the pressure equation on given field, grid and boundary
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     * @param[in] boundary to be used
+     */
+    virtual double solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries);
+
+    /**
+     * @brief Restarts the conjugate gradient method
+     *
+     * @param[in] field to be used
+     * @param[in] grid to be used
+     */
+    virtual void initialize(Fields &field, Grid &grid);
+
+    /// Multigrid hierarchy
+    const AlgebraicMultigrid &multigrid() const { return _multigrid; }
+
+  private:
+    /// Negated residual RS - laplacian(P) of the fluid cells, projected if singular
+    void defect(Fields &field, Grid &grid, std::vector<double> &b) const;
+
+    /// Adds scale times a correction of the fluid cells to the pressure, including the boundary cells
+    void correct(Fields &field, const std::vector<double> &e, double scale);
+
+    /// Removes the mean of a vector if the constant is in the null space
+    void project(std::vector<double> &x) const;
+
+    /// Dot product of two vectors of the unknowns
+    static double dot(const std::vector<double> &x, const std::vector<double> &y);
+
+    bool _pcg;
+    /// Number of cells in x direction including ghost cells
+    int _stride;
+    /// Linear index of the cell of every unknown
+    std::vector<int> _cells;
+    HomogeneousPressureBoundary _boundary;
+    AlgebraicMultigrid _multigrid;
+
+    /// Conjugate gradient state
+    bool _started{false};
+    double _rz{0.0};
+    std::vector<double> _r;
+    std::vector<double> _z;
+    std::vector<double> _d;
+    std::vector<double> _q;
+    /// Correction of all cells
+    std::vector<double> _update;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+/**
+ * @brief Settings of the scaling benchmark
+ */
+struct ScalingSettings {
+    /// Generated problem, cavity or channel
+    std::string problem{"cavity"};
+    /// Cells per side of the problem of a single worker
+    int size{256};
+    /// Swept thread counts, powers of two up to the hardware threads if empty
+    std::vector<int> threads;
+    /// Timesteps per run
+    int steps{20};
+    /// Pressure iterations per timestep, fixed to keep the work per step constant
+    int sor_iterations{20};
+
+    /**
+     * @brief Reads the settings from the command line
+     *
+     * @param[in] number of arguments
+     * @param[in] arguments following --scaling
+     * @param[out] false on an invalid argument
+     */
+    bool parse(int argn, char **args);
+};
+
+/**
+ * @brief Strong and weak scaling benchmark of the time loop
+ *
+ * Generated lid driven cavity or channel problems are run for a fixed number
+ * of timesteps over a sweep of thread counts. Strong scaling keeps the problem
+ * at size x size cells, weak scaling grows it with the number of workers. The
+ * time per step is split into compute (fluxes, right hand side, wavefront
+ * parallel SOR sweeps, velocities), boundary (ghost cell updates, the shared-memory counterpart of
+ * a halo exchange), reductions (pressure residual and timestep size) and I/O
+ * (a solution file per run).
+ */
+class ScalingBenchmark {
+  public:
+    explicit ScalingBenchmark(const ScalingSettings &settings);
+
+    /// Runs the sweeps and prints the efficiency tables
+    void run();
+
+  private:
+    /// Time per step of each part in seconds
+    struct Timing {
+        double compute{0.0};
+        double boundary{0.0};
+        double reduction{0.0};
+        double io{0.0};
+        double total() const { return compute + boundary + reduction + io; }
+    };
+
+    /**
+     * @brief Runs one generated problem
+     *
+     * @param[in] number of cells in x direction
+     * @param[in] number of cells in y direction
+     * @param[in] number of threads
+     * @param[out] time per step of each part
+     */
+    Timing run_problem(int nx, int ny, int threads);
+
+    /**
+     * @brief Prints a scaling table
+     *
+     * @param[in] table title
+     * @param[in] swept thread counts
+     * @param[in] cells of each run
+     * @param[in] timings of each run
+     * @param[in] weak scaling efficiency if true, strong scaling efficiency otherwise
+     */
+    void print_table(const std::string &title, const std::vector<int> &threads, const std::vector<long> &cells,
+                     const std::vector<Timing> &timings, bool weak) const;
+
+    ScalingSettings _settings;
+};
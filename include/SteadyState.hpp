@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <ostream>
+
+#include "Datastructures.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+
+/**
+ * @brief Detection of the steady state of a run
+ *
+ * After every timestep, the change of U, V, P and, with the energy equation,
+ * T per unit time is measured over the fluid cells in the L2 and maximum
+ * norms, relative to the largest magnitude of the field. The mean change of
+ * P is removed first, since the pressure level is arbitrary without an
+ * outflow. The run is steady once the L2 or the maximum norms of all fields
+ * stayed below the tolerance for a number of consecutive timesteps. The
+ * maximum norm also catches local changes, but it is more sensitive to the
+ * error the pressure solves leave in P.
+ */
+class SteadyState {
+  public:
+    SteadyState() = default;
+
+    /**
+     * @brief Constructor of the steady state detection
+     *
+     * @param[in] tolerance of the relative change per unit time
+     * @param[in] number of consecutive timesteps the change has to stay below the tolerance
+     * @param[in] whether the maximum norm is checked instead of the L2 norm
+     * @param[in] whether the temperature is checked
+     */
+    SteadyState(double tolerance, int steps, bool max_norm, bool energy_eq);
+
+    /**
+     * @brief Measures the change of the fields over a timestep
+     *
+     * The first call only stores the fields.
+     *
+     * @param[in] fields at the end of the timestep
+     * @param[in] grid
+     * @param[in] timestep size
+     * @param[out] whether the run is steady
+     */
+    bool update(const Fields &field, Grid &grid, double dt);
+
+    /// Whether the run was found steady
+    bool steady() const { return _below >= _steps; }
+
+    /**
+     * @brief Prints the changes of the last timestep
+     *
+     * @param[in] output stream
+     */
+    void report(std::ostream &out) const;
+
+  private:
+    double _tolerance{0.0};
+    int _steps{1};
+    bool _max_norm{false};
+    int _num_fields{3};
+    /// Consecutive timesteps with all changes below the tolerance
+    int _below{0};
+    bool _has_previous{false};
+    /// U, V, P and T at the end of the previous timestep
+    std::array<Matrix<double>, 4> _previous;
+    /// Relative changes per unit time of the last timestep
+    std::array<double, 4> _l2{};
+    std::array<double, 4> _max{};
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Enums.hpp"
+
+/// Number of timed phases of a timestep
+constexpr int num_step_phases = static_cast<int>(step_phase::COUNT);
+
+/// Name of a timestep phase
+const char *step_phase_name(step_phase phase);
+
+class PerfCounters;
+
+/**
+ * @brief Wall clock timer of the phases of a timestep
+ *
+ * Elapsed times of repeated start/stop pairs of the same phase accumulate
+ * until the timer is reset.
+ */
+class PhaseTimer {
+  public:
+    /// Starts timing the given phase
+    void start(step_phase phase);
+
+    /// Stops timing the given phase and accumulates the elapsed time
+    void stop(step_phase phase);
+
+    /// Accumulated time of the given phase in seconds
+    double elapsed(step_phase phase) const;
+
+    /// Resets the accumulated times of all phases
+    void reset();
+
+    /// Counts hardware events over the same phases, detached if null
+    void attach(PerfCounters *counters);
+
+  private:
+    std::array<std::chrono::steady_clock::time_point, num_step_phases> _start;
+    std::array<double, num_step_phases> _elapsed{};
+    PerfCounters *_counters{nullptr};
+};
+
+/**
+ * @brief Fixed size record of a single timestep in the binary step log
+ */
+struct StepRecord {
+    /// Simulation time
+    double t;
+    /// Timestep size
+    double dt;
+    /// Final residual of the pressure solver
+    double residual;
+    /// Number of pressure solver iterations
+    int64_t iterations;
+    /// Wall clock time of each phase in seconds
+    double phase_time[num_step_phases];
+};
+
+/**
+ * @brief Header of the binary step log
+ *
+ * The header is followed by a plain sequence of StepRecord. The record size,
+ * the number of phases and the phase names are stored in the header, and
+ * num_phases names are followed by the records, so that the decoder does not
+ * depend on the phases compiled into the solver.
+ */
+struct StepLogHeader {
+    /// File signature
+    char magic[8];
+    /// Size of a single record in bytes
+    int32_t record_size;
+    /// Number of phases in each record
+    int32_t num_phases;
+    /// Zero terminated phase names
+    char phase_names[num_step_phases][16];
+};
+
+/// Signature of the binary step log
+constexpr char step_log_magic[8] = {'F', 'L', 'C', 'H', 'S', 'T', 'P', '1'};
+
+/**
+ * @brief Buffered writer of the binary step log
+ *
+ * Records are collected in memory and written in large blocks, so that
+ * writing the log costs neither formatting nor a system call per timestep.
+ */
+class StepLog {
+  public:
+    StepLog() = default;
+    ~StepLog();
+
+    /**
+     * @brief Opens the log and writes the header
+     *
+     * @param[in] file name of the log
+     * @param[in] number of records kept in memory before writing
+     */
+    void open(const std::string &file_name, int buffer_records = 8192);
+
+    /// Appends a record to the log
+    void write(const StepRecord &record);
+
+    /// Writes the buffered records to the file
+    void flush();
+
+    /// Writes the buffered records and closes the file
+    void close();
+
+    /// Whether the log is open
+    bool is_open() const;
+
+  private:
+    std::ofstream _file;
+    std::vector<StepRecord> _buffer;
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Timeline of the run in the Chrome Trace Event format
+ *
+ * Events are buffered in memory per thread and written as a whole at the
+ * end of the run, so that recording costs two clock reads and a store.
+ * Event names and categories must be string literals, they are stored as
+ * pointers. The written file can be opened in chrome://tracing or Perfetto.
+ */
+class Trace {
+  public:
+    using clock = std::chrono::steady_clock;
+
+    /// Starts recording, event times are relative to this call
+    static void enable();
+
+    /// Whether events are recorded
+    static bool enabled() { return _enabled; }
+
+    /// Time since enabling in nanoseconds
+    static int64_t now() { return since_start(clock::now()); }
+
+    /// Time of a clock reading since enabling in nanoseconds
+    static int64_t since_start(clock::time_point time);
+
+    /**
+     * @brief Records a complete event of the calling thread
+     *
+     * @param[in] event name
+     * @param[in] event category
+     * @param[in] begin in nanoseconds since enabling
+     * @param[in] end in nanoseconds since enabling
+     * @param[in] optional integer argument, omitted if negative
+     */
+    static void record(const char *name, const char *category, int64_t begin, int64_t end, int64_t arg = -1);
+
+    /**
+     * @brief Writes all recorded events
+     *
+     * @param[in] output file name
+     */
+    static void write(const std::string &file_name);
+
+  private:
+    static bool _enabled;
+    static clock::time_point _start;
+};
+
+/**
+ * @brief Records an event spanning the lifetime of the scope
+ */
+class TraceScope {
+  public:
+    TraceScope(const char *name, const char *category, int64_t arg = -1)
+        : _name(name), _category(category), _arg(arg), _begin(Trace::enabled() ? Trace::now() : 0) {}
+
+    ~TraceScope() {
+        if (Trace::enabled()) Trace::record(_name, _category, _begin, Trace::now(), _arg);
+    }
+
+  private:
+    const char *_name;
+    const char *_category;
+    int64_t _arg;
+    int64_t _begin;
+};
@@ -1,8 +1,14 @@
 #include "Case.hpp"
+#include "Compression.hpp"
 #include "Enums.hpp"
+#include "GridSequence.hpp"
+#include "Output.hpp"
+#include "Parallel.hpp"
+#include "Trace.hpp"
 
 #include <algorithm>
 #include <chrono>
+#include <cmath>
 #include <iomanip>
 #include <iterator>
 #include <string>
@@ -16,22 +22,17 @@
 #include <ios>
 #include <iostream>
 #include <map>
+#include <sstream>
 #include <vector>
 
+#include <sys/resource.h>
+
 #ifdef GCC_VERSION_9_OR_HIGHER
 namespace filesystem = std::filesystem;
 #else
 namespace filesystem = std::experimental::filesystem;
 #endif
 
-#include <vtkCellData.h>
-#include <vtkDoubleArray.h>
-#include <vtkPointData.h>
-#include <vtkPoints.h>
-#include <vtkSmartPointer.h>
-#include <vtkStructuredGrid.h>
-#include <vtkStructuredGridWriter.h>
-#include <vtkTuple.h>
 
 Case::Case(std::string file_name, int argn, char **args) {
     // Read input parameters
@@ -48,8 +49,19 @@ Case::Case(std::string file_name, int argn, char **args) {
     double dt;       /* time step */
     int imax;        /* number of cells x-direction*/
     int jmax;        /* number of cells y-direction*/
+    std::string stretch_x = "uniform"; /* grid stretching x-direction, uniform, tanh or geometric */
+    std::string stretch_y = "uniform"; /* grid stretching y-direction, uniform, tanh or geometric */
+    double stretch_x_param = 0.0;      /* stretching parameter x-direction */
+    double stretch_y_param = 0.0;      /* stretching parameter y-direction */
+    std::string storage = "dense";     /* storage of the fields, dense or tiled */
     double gamma;    /* upwind differencing factor*/
-    double omg;      /* relaxation factor */
+    double omg = OmegaTuner::initial_omega; /* relaxation factor, tuned at runtime if auto */
+    std::string solver = "sor";             /* pressure solver, see README */
+    int inner_sweeps = 8;                   /* single-precision sweeps per mixed_sor iteration */
+    int blocked_sweeps = 4;                 /* sweeps per blocked_sor iteration */
+    std::string diffusion = "explicit";     /* diffusion terms explicit or implicit (ADI) */
+    double dt_max = 0.0;                    /* max. timestep size with implicit diffusion, dt if not positive */
+    std::string time_integration = "euler"; /* time integration of the explicit terms, euler or ab2 */
     double tau;      /* safety factor for time step*/
     int itermax;     /* max. number of iterations for pressure per time step */
     double eps;      /* accuracy bound for pressure*/
@@ -70,11 +82,39 @@ Case::Case(std::string file_name, int argn, char **args) {
     double beta;  /* Thermal Expansion Coefficient  */
     double alpha; /* Thermal diffusivity   */
 
+    /* MONITOR VARIABLES*/
+    int monitor_freq = 1;                 /* Monitor evaluation frequency in timesteps */
+    std::string monitor_format = "csv";   /* Monitor time series format, csv or binary */
+    bool monitor_heat_flux = false;       /* Heat flux over the hot walls */
+    bool monitor_kinetic_energy = false;  /* Kinetic energy of the fluid */
+    bool monitor_mass_flux = false;       /* Mass flux over inflow and outflow */
+
+    /* STATISTICS VARIABLES*/
+    bool statistics = false; /* Running mean and RMS of U, V, P and T */
+
+    /* STEADY STATE VARIABLES*/
+    bool steady = false;      /* Stop once the run is steady */
+    double steady_tol = 1e-4; /* Relative change of U, V, P and T per unit time considered steady */
+    int steady_steps = 10;    /* Consecutive timesteps the change has to stay below steady_tol */
+    std::string steady_norm = "l2"; /* Norm of the change, l2 or max */
+
+    /* GRID SEQUENCING VARIABLES*/
+    int grid_sequence = 0;             /* Number of coarse levels run before the fine grid */
+    double grid_sequence_tol = 1e-3;   /* Relative change per unit time a coarse level is run to */
+    double grid_sequence_t_end = 0.0;  /* Max. simulation time of a coarse level, t_end if not positive */
+
+    /* CONVERGENCE VARIABLES*/
+    bool residual_history = false; /* Sampled residual history and relaxation factor estimate */
+    int residual_history_freq = 10; /* Residual history of every n-th pressure solve is written */
+
+    /* OUTPUT VARIABLES*/
+    bool compressed_output = false; /* Error-bounded compressed solution files */
+    double error_bound = 0.0;       /* Absolute error bound of the compressed values */
+
     if (file.is_open()) {
 
         std::string var;
-        while (!file.eof() && file.good()) {
-            file >> var;
+        while (file >> var) {
             if (var[0] == '#') { /* ignore comment line*/
                 file.ignore(MAX_LINE_LENGTH, '\n');
             } else {
@@ -83,7 +123,24 @@ Case::Case(std::string file_name, int argn, char **args) {
                 if (var == "nu") file >> nu;
                 if (var == "t_end") file >> _t_end;
                 if (var == "dt") file >> dt;
-                if (var == "omg") file >> omg;
+                if (var == "omg") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "auto") {
+                        _omega_auto = true;
+                    } else {
+                        omg = std::stod(temp);
+                    }
+                }
+                if (var == "stretch_x") file >> stretch_x >> stretch_x_param;
+                if (var == "stretch_y") file >> stretch_y >> stretch_y_param;
+                if (var == "storage") file >> storage;
+                if (var == "solver") file >> solver;
+                if (var == "inner_sweeps") file >> inner_sweeps;
+                if (var == "blocked_sweeps") file >> blocked_sweeps;
+                if (var == "diffusion") file >> diffusion;
+                if (var == "dt_max") file >> dt_max;
+                if (var == "time_integration") file >> time_integration;
                 if (var == "eps") file >> eps;
                 if (var == "tau") file >> tau;
                 if (var == "gamma") file >> gamma;
@@ -114,11 +171,113 @@ Case::Case(std::string file_name, int argn, char **args) {
                 if (var == "beta") file >> beta;
                 if (var == "alpha") file >> alpha;
                 if (var == "group_id") file >> _rank;
+
+                if (var == "log_format") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "binary") _binary_log = true;
+                }
+
+                if (var == "output_fields") {
+                    std::string temp;
+                    file >> temp;
+                    _output_settings.select_fields(temp);
+                }
+                if (var == "output_window") {
+                    file >> _output_settings.imin >> _output_settings.imax >> _output_settings.jmin >>
+                        _output_settings.jmax;
+                }
+                if (var == "output_stride") file >> _output_settings.stride;
+                if (var == "output_full_dt") file >> _output_full_freq;
+                if (var == "output_format") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "compressed") compressed_output = true;
+                }
+                if (var == "output_error_bound") file >> error_bound;
+
+                if (var == "statistics") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") statistics = true;
+                }
+                if (var == "residual_history") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") residual_history = true;
+                }
+                if (var == "residual_history_freq") file >> residual_history_freq;
+                if (var == "steady") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") steady = true;
+                }
+                if (var == "steady_tol") file >> steady_tol;
+                if (var == "steady_steps") file >> steady_steps;
+                if (var == "steady_norm") file >> steady_norm;
+                if (var == "grid_sequence") file >> grid_sequence;
+                if (var == "grid_sequence_tol") file >> grid_sequence_tol;
+                if (var == "grid_sequence_t_end") file >> grid_sequence_t_end;
+
+                if (var == "statistics_start") file >> _statistics_start;
+                if (var == "statistics_dt") file >> _statistics_freq;
+
+                if (var == "monitor_freq") file >> monitor_freq;
+                if (var == "monitor_format") file >> monitor_format;
+                if (var == "monitor_probe") {
+                    double x, y;
+                    file >> x >> y;
+                    _monitor.add_probe(x, y);
+                }
+                if (var == "monitor_line") {
+                    double x0, y0, x1, y1;
+                    int n;
+                    file >> x0 >> y0 >> x1 >> y1 >> n;
+                    _monitor.add_line(x0, y0, x1, y1, n);
+                }
+                if (var == "monitor_heat_flux") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") monitor_heat_flux = true;
+                }
+                if (var == "monitor_kinetic_energy") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") monitor_kinetic_energy = true;
+                }
+                if (var == "monitor_mass_flux") {
+                    std::string temp;
+                    file >> temp;
+                    if (temp == "on") monitor_mass_flux = true;
+                }
             }
         }
     }
     file.close();
 
+    // Command line options following the input file
+    for (int k = 2; k < argn; ++k) {
+        std::string arg(args[k]);
+        if (arg == "--max-steps" && k + 1 < argn) {
+            _max_steps = std::stoi(args[++k]);
+        } else if (arg == "--threads" && k + 1 < argn) {
+            Parallel::set_num_threads(std::stoi(args[++k]));
+        } else if (arg == "--perf-counters") {
+            _perf_counters = true;
+        } else if (arg == "--perf-vector-event" && k + 1 < argn) {
+            _perf_counters = true;
+            _perf_vector_event = std::stoull(args[++k], nullptr, 0);
+        } else if (arg == "--trace" && k + 1 < argn) {
+            _trace_file = args[++k];
+        } else if (arg == "--no-output") {
+            _no_output = true;
+        } else if (arg == "--bench-json" && k + 1 < argn) {
+            _bench_json = args[++k];
+        } else {
+            std::cout << "Unknown command line option " << arg << " is ignored." << std::endl;
+        }
+    }
+
     std::map<int, double> wall_vel;
     if (_geom_name.compare("NONE") == 0) {
         wall_vel.insert(std::pair<int, double>(LidDrivenCavity::moving_wall_id, LidDrivenCavity::wall_velocity));
@@ -137,43 +296,191 @@ Case::Case(std::string file_name, int argn, char **args) {
     build_domain(domain, imax, jmax);
 
     _grid = Grid(_geom_name, domain);
+    for (const auto &stretch : {stretch_x, stretch_y}) {
+        if (stretch != "uniform" && stretch != "tanh" && stretch != "geometric") {
+            std::cout << "Unknown grid stretching " << stretch << ", using uniform." << std::endl;
+        }
+    }
+    if (stretch_x == "tanh" || stretch_x == "geometric" || stretch_y == "tanh" || stretch_y == "geometric") {
+        _grid.set_spacing(Grid::stretching(stretch_x, stretch_x_param, xlength, imax),
+                          Grid::stretching(stretch_y, stretch_y_param, ylength, jmax));
+        std::cout << "Stretched grid, smallest cell " << _grid.min_dx() << " x " << _grid.min_dy() << "." << std::endl;
+        // Features which assume uniform cell sizes
+        if (solver != "sor") {
+            std::cout << "The " << solver << " solver assumes a uniform grid, using sor." << std::endl;
+            solver = "sor";
+        }
+        if (diffusion == "implicit") {
+            std::cout << "Implicit diffusion assumes a uniform grid, using explicit." << std::endl;
+            diffusion = "explicit";
+        }
+        if (grid_sequence > 0) {
+            std::cout << "Grid sequencing assumes a uniform grid and is disabled." << std::endl;
+            grid_sequence = 0;
+        }
+    }
+    if (storage == "tiled") {
+        _grid.set_tiling();
+        const auto &tiles = *_grid.tiles();
+        std::cout << "Tiled storage, " << tiles.active.size() << " of " << tiles.slots.size() << " tiles of "
+                  << TileMap::tile_size << " x " << TileMap::tile_size << " cells allocated, "
+                  << 100.0 * tiles.storage() / (_grid.imaxb() * _grid.jmaxb()) << "% of the dense storage."
+                  << std::endl;
+        // Solvers which address the dense storage directly
+        if (solver != "sor") {
+            std::cout << "The " << solver << " solver requires dense storage, using sor." << std::endl;
+            solver = "sor";
+        }
+        if (diffusion == "implicit") {
+            std::cout << "Implicit diffusion requires dense storage, using explicit." << std::endl;
+            diffusion = "explicit";
+        }
+        // The coarse levels are interpolated to all cells of the fine grid
+        if (grid_sequence > 0) {
+            std::cout << "Grid sequencing requires dense storage and is disabled." << std::endl;
+            grid_sequence = 0;
+        }
+    } else if (storage != "dense") {
+        std::cout << "Unknown storage " << storage << ", using dense." << std::endl;
+    }
     if (!_energy_eq) {
         _field = Fields(_grid, nu, dt, tau, UI, VI, PI, GX, GY);
     } else {
         _field = Fields(_grid, nu, alpha, beta, dt, tau, UI, VI, PI, TI, GX, GY);
     }
 
-    _discretization = Discretization(domain.dx, domain.dy, gamma);
-    _pressure_solver = std::make_unique<SOR>(omg);
+    if (statistics) {
+        _field.enable_statistics(_grid, _energy_eq);
+    }
+
+    if (steady) {
+        _steady = true;
+        _steady_state = SteadyState(steady_tol, steady_steps, steady_norm == "max", _energy_eq);
+    }
+
+    if (time_integration == "ab2") {
+        _field.set_time_scheme(time_scheme::AB2);
+    } else if (time_integration != "euler") {
+        std::cout << "Unknown time integration " << time_integration << ", using euler." << std::endl;
+    }
+
+    if (compressed_output) {
+        if (error_bound > 0) {
+            _output_error_bound = error_bound;
+        } else {
+            std::cout << "Compressed output requires a positive output_error_bound, writing .vtk files instead."
+                      << std::endl;
+        }
+    }
+
+    _discretization = Discretization(_grid, gamma);
     _max_iter = itermax;
     _tolerance = eps;
 
-    std::map<int, double> temp1 = {{3, wall_temp_3}};
-    std::map<int, double> temp2 = {{4, wall_temp_4}};
-    std::map<int, double> temp3 = {{5, wall_temp_5}};
+    if (_omega_auto) {
+        // The tuner needs the convergence factor of every solve
+        _convergence_analysis = true;
+        _omega_cache = _dict_name + "/omega_cache.txt";
+        _omega_cache_key = omega_cache_key();
+        double cached = OmegaTuner::load(_omega_cache, _omega_cache_key);
+        if (cached > 0.0) {
+            omg = cached;
+            std::cout << "Relaxation factor " << omg << " read from " << _omega_cache << std::endl;
+        }
+        _omega_tuner.start(omg, cached > 0.0);
+    }
+    if (solver == "line_sor") {
+        _pressure_solver = std::make_unique<LineSOR>(omg);
+    } else if (solver == "mixed_sor") {
+        _pressure_solver = std::make_unique<MixedPrecisionSOR>(omg, inner_sweeps);
+    } else if (solver == "blocked_sor") {
+        _pressure_solver = std::make_unique<BlockedSOR>(omg, blocked_sweeps);
+    } else if (solver == "wavefront_sor") {
+        _pressure_solver = std::make_unique<WavefrontSOR>(omg);
+    } else if (solver == "chebyshev") {
+        _pressure_solver = std::make_unique<ChebyshevJacobi>();
+    } else if (solver == "amg" || solver == "amg_pcg") {
+        auto amg = std::make_unique<AMGSolver>(_grid, solver == "amg_pcg");
+        amg->multigrid().report(std::cout);
+        _pressure_solver = std::move(amg);
+    } else {
+        if (solver != "sor") std::cout << "Unknown pressure solver " << solver << ", using sor." << std::endl;
+        solver = "sor";
+        _pressure_solver = std::make_unique<SOR>(omg);
+    }
+    if (_omega_auto && solver != "sor" && solver != "line_sor" && solver != "mixed_sor" && solver != "blocked_sor" &&
+        solver != "wavefront_sor") {
+        std::cout << "The " << solver << " solver has no relaxation factor, omg auto is ignored." << std::endl;
+        _omega_auto = false;
+    }
+
+    if (residual_history) {
+        _convergence_analysis = true;
+        _residual_history_freq = std::max(residual_history_freq, 1);
+    }
+    _convergence.set_omega(omg);
+    _convergence.set_sweeps(_pressure_solver->sweeps_per_solve());
 
     // Construct boundaries
-    if (not _grid.moving_wall_cells().empty()) {
-        _boundaries.push_back(
-            std::make_unique<MovingWallBoundary>(_grid.moving_wall_cells(), LidDrivenCavity::wall_velocity));
+    _inflow_velocity = {UIN, VIN};
+    _outflow_pressure = P_out;
+    _wall_temperature = {wall_temp_3, wall_temp_4, wall_temp_5};
+    build_boundaries(_grid, _boundaries);
+
+    if (grid_sequence > 0) {
+        _grid_sequence = GridSequence(grid_sequence, grid_sequence_tol,
+                                      grid_sequence_t_end > 0.0 ? grid_sequence_t_end : _t_end, omg, gamma);
+        if (_grid_sequence.levels(_grid) < grid_sequence) {
+            std::cout << "The grid allows " << _grid_sequence.levels(_grid) << " of " << grid_sequence
+                      << " grid sequencing levels." << std::endl;
+        }
+    }
+
+    if (diffusion == "implicit") {
+        _diffusion = std::make_unique<ImplicitDiffusion>(_grid, _field, _boundaries, _energy_eq);
+        _field.set_diffusion(_diffusion.get(), dt_max > 0.0 ? dt_max : dt);
+    } else if (diffusion != "explicit") {
+        std::cout << "Unknown diffusion treatment " << diffusion << ", using explicit." << std::endl;
+    }
+
+    // Configure monitors
+    _monitor.set_frequency(monitor_freq);
+    _monitor.set_format(monitor_format);
+    if (monitor_heat_flux) {
+        double delta_temperature = wall_temp_4 - wall_temp_3;
+        _monitor.enable_heat_flux(wall_temp_4, delta_temperature != 0.0 ? delta_temperature : 1.0);
     }
-    if (not _grid.fixed_wall_cells().empty()) {
-        _boundaries.push_back(std::make_unique<FixedWallBoundary>(_grid.fixed_wall_cells()));
+    if (monitor_kinetic_energy) _monitor.enable_kinetic_energy();
+    if (monitor_mass_flux) _monitor.enable_mass_flux();
+}
+
+void Case::build_boundaries(const Grid &grid, std::vector<std::unique_ptr<Boundary>> &boundaries) const {
+    std::map<int, double> temp1 = {{3, _wall_temperature[0]}};
+    std::map<int, double> temp2 = {{4, _wall_temperature[1]}};
+    std::map<int, double> temp3 = {{5, _wall_temperature[2]}};
+
+    if (not grid.moving_wall_cells().empty()) {
+        boundaries.push_back(
+            std::make_unique<MovingWallBoundary>(grid.moving_wall_cells(), LidDrivenCavity::wall_velocity));
     }
-    if (not _grid.cold_fixed_wall_cells().empty()) {
-        _boundaries.push_back(std::make_unique<FixedWallBoundary>(_grid.cold_fixed_wall_cells(), temp1));
+    if (not grid.fixed_wall_cells().empty()) {
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.fixed_wall_cells()));
     }
-    if (not _grid.hot_fixed_wall_cells().empty()) {
-        _boundaries.push_back(std::make_unique<FixedWallBoundary>(_grid.hot_fixed_wall_cells(), temp2));
+    if (not grid.cold_fixed_wall_cells().empty()) {
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.cold_fixed_wall_cells(), temp1));
     }
-    if (not _grid.adiabatic_fixed_wall_cells().empty()) {
-        _boundaries.push_back(std::make_unique<FixedWallBoundary>(_grid.adiabatic_fixed_wall_cells(), temp3));
+    if (not grid.hot_fixed_wall_cells().empty()) {
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.hot_fixed_wall_cells(), temp2));
     }
-    if (not _grid.inflow_cells().empty()) {
-        _boundaries.push_back(std::make_unique<InflowBoundary>(_grid.inflow_cells(), UIN, VIN));
+    if (not grid.adiabatic_fixed_wall_cells().empty()) {
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.adiabatic_fixed_wall_cells(), temp3));
     }
-    if (not _grid.outflow_cells().empty()) {
-        _boundaries.push_back(std::make_unique<OutflowBoundary>(_grid.outflow_cells(),P_out));
+    if (not grid.inflow_cells().empty()) {
+        boundaries.push_back(
+            std::make_unique<InflowBoundary>(grid.inflow_cells(), _inflow_velocity[0], _inflow_velocity[1]));
+    }
+    if (not grid.outflow_cells().empty()) {
+        boundaries.push_back(std::make_unique<OutflowBoundary>(grid.outflow_cells(), _outflow_pressure));
     }
 }
 
@@ -251,267 +558,434 @@ void Case::simulate() {
 
     writeIntro(output_file);
 
+    StepLog step_log;
+    if (_binary_log) {
+        step_log.open(_dict_name + '/' + _case_name + "_steps.bin");
+    }
+
     double t = 0.0;
     double dt = _field.dt();
     int timestep = 0;
+    int step = 0; // Number of performed timesteps
     double output_counter = 0.0;
+    double full_output_counter = 0.0;
+    int full_timestep = 0;
+    double statistics_counter = 0.0;
+    int statistics_output = 0;
     uint8_t counter = 0; // Counter for printing values on the console
 
-    auto start = std::chrono::steady_clock::now();
+    if (!_trace_file.empty()) {
+        Trace::enable();
+    }
 
-    output_vtk(timestep++, _rank); // Writing intial data
+    auto start = std::chrono::steady_clock::now();
 
-    if (!_energy_eq) {
-        std::cout << "ENERGY EQUATION OFF" << std::endl;
-        while (t < _t_end) {
+    if (_grid_sequence.levels(_grid) > 0) {
+        run_grid_sequence(output_file);
+    }
 
-            // Apply BCs
-            for (auto &i : _boundaries) {
-                i->apply(_field);
-            }
+    output_vtk(timestep++, _rank); // Writing intial data
+    if (_output_full_freq > 0) {
+        output_vtk(full_timestep++, _rank, true);
+    }
 
-            // Calculate Fluxes
-            _field.calculate_fluxes(_grid);
+    if (_convergence_analysis && _residual_history_freq > 0 && !_no_output) {
+        _convergence.open_history(_dict_name + '/' + _case_name + "_residuals.csv", _residual_history_freq);
+    }
 
-            // Calculate RHS of PPE
-            _field.calculate_rs(_grid);
+    if (_monitor.active() && !_no_output) {
+        _monitor.open(_dict_name + '/' + _case_name, _energy_eq);
+    }
 
-            // Perform SOR Iterations
-            int it = 0;
-            double res = 1000.;
-            while (it <= _max_iter && res >= _tolerance) {
-                for (auto &i : _boundaries) {
-                    i->apply_pressure(_field);
-                }
-                res = _pressure_solver->solve(_field, _grid, _boundaries);
-                it++;
-            }
+    if (!_energy_eq) {
+        std::cout << "ENERGY EQUATION OFF" << std::endl;
+    } else {
+        std::cout << "ENERGY EQN ON" << std::endl;
+    }
 
-            // Calculate Velocities U and V
-            _field.calculate_velocities(_grid);
-
-            // Storing the values in the VTK file
-            output_counter += dt;
-            if (output_counter >= _output_freq) {
-                output_vtk(timestep++, _rank);
-                output_counter = 0;
-                std::cout << "\n[" << static_cast<int>((t / _t_end) * 100) << "%"
-                          << " completed] Writing Data at t=" << t << "s"
-                          << "\n\n";
-            }
+    if (_perf_counters) {
+        if (_counters.open(_perf_vector_event)) {
+            _timer.attach(&_counters);
+        } else {
+            std::cout << "Hardware performance counters are not available, check perf_event_paranoid." << std::endl;
+        }
+    }
 
-            // Writing simulation data in a log file
-            output_file << std::left << "Simulation Time[s] = " << std::setw(7) << t
-                        << "\tTime Step[s] = " << std::setw(7) << dt << "\tSOR Iterations = " << std::setw(3) << it
-                        << "\tSOR Residual = " << std::setw(7) << res << "\n";
+    int64_t total_iterations = 0;
+    int max_iterations = 0;
+    std::array<double, num_step_phases> phase_time{};
+    auto loop_start = std::chrono::steady_clock::now();
 
-            // Printing info and checking for errors once in 5 runs of the loop
-            if (counter == 10) {
-                counter = 0;
-                std::cout << std::left << "Simulation Time[s] = " << std::setw(7) << t
-                          << "\tTime Step[s] = " << std::setw(7) << dt << "\tSOR Iterations = " << std::setw(3) << it
-                          << "\tSOR Residual = " << std::setw(7) << res << "\n";
-                // Check for unphysical behaviour
-                if (check_err(_field, _grid.imax(), _grid.jmax())) exit(0);
-            }
-            counter++;
+    while (t < _t_end && (_max_steps <= 0 || step < _max_steps)) {
+        TraceScope step_scope("timestep", "step", step);
+        _timer.reset();
 
-            // Updating current time
-            t = t + dt;
+        // Apply BCs
+        _timer.start(step_phase::BOUNDARY);
+        for (auto &i : _boundaries) {
+            i->apply(_field);
+            if (_energy_eq) i->apply_temperature(_field);
+        }
+        _timer.stop(step_phase::BOUNDARY);
 
-            // Calculate Adaptive Time step
-            dt = _field.calculate_dt(_grid);
+        // Calculate Temperatures
+        if (_energy_eq) {
+            _timer.start(step_phase::TEMPERATURE);
+            _field.calculate_temperatures(_grid);
+            _timer.stop(step_phase::TEMPERATURE);
         }
-    } else {
-        std::cout << "ENERGY EQN ON" << std::endl;
-        while (t < _t_end) {
 
-            // Apply BCs
+        // Calculate Fluxes
+        _timer.start(step_phase::FLUXES);
+        _field.calculate_fluxes(_grid, _energy_eq);
+        _timer.stop(step_phase::FLUXES);
+
+        // Calculate RHS of PPE
+        _timer.start(step_phase::RHS);
+        _field.calculate_rs(_grid);
+        _timer.stop(step_phase::RHS);
+
+        // Perform SOR Iterations
+        _timer.start(step_phase::PRESSURE);
+        int it = 0;
+        double res = 1000.;
+        int64_t batch_begin = Trace::enabled() ? Trace::now() : 0;
+        if (_convergence_analysis) _convergence.begin_solve();
+        _pressure_solver->initialize(_field, _grid);
+        while (it <= _max_iter && res >= _tolerance) {
             for (auto &i : _boundaries) {
-                i->apply(_field);
-                i->apply_temperature(_field);
+                i->apply_pressure(_field);
+            }
+            res = _pressure_solver->solve(_field, _grid, _boundaries);
+            it++;
+            if (_convergence_analysis) _convergence.add_residual(res);
+
+            // Pressure iterations are traced in batches, the last batch may be shorter
+            if (Trace::enabled() && (it % trace_batch_size == 0 || !(it <= _max_iter && res >= _tolerance))) {
+                int64_t batch_end = Trace::now();
+                Trace::record("sor iterations", "pressure", batch_begin, batch_end, (it - 1) % trace_batch_size + 1);
+                batch_begin = batch_end;
             }
+        }
+        if (_convergence_analysis) _convergence.end_solve(step, t);
+        if (_omega_auto && _omega_tuner.update(_convergence.last_factor(), it)) {
+            _pressure_solver->set_omega(_omega_tuner.omega());
+            _convergence.set_omega(_omega_tuner.omega());
+            std::cout << "Relaxation factor set to " << _omega_tuner.omega() << " at timestep " << step
+                      << std::endl;
+        }
+        _timer.stop(step_phase::PRESSURE);
 
-            // Calculate Temperatures
-            _field.calculate_temperatures(_grid);
+        // Calculate Velocities U and V
+        _timer.start(step_phase::VELOCITIES);
+        _field.calculate_velocities(_grid);
+        _timer.stop(step_phase::VELOCITIES);
 
-            // Calculate Fluxes
-            _field.calculate_fluxes(_grid, _energy_eq);
+        _timer.start(step_phase::OUTPUT);
 
-            // Calculate RHS of PPE
-            _field.calculate_rs(_grid);
+        // Evaluate in-situ monitors
+        if (_monitor.due(step) && !_no_output) {
+            TraceScope scope("monitors", "io", step);
+            _monitor.evaluate(_field, _grid, t + dt);
+        }
 
-            // Perform SOR Iterations
-            int it = 0;
-            double res = 1000.;
-            while (it <= _max_iter && res >= _tolerance) {
-                for (auto &i : _boundaries) {
-                    i->apply_pressure(_field);
-                }
-                res = _pressure_solver->solve(_field, _grid, _boundaries);
-                it++;
-            }
+        // Measure the change of the fields over the timestep
+        bool steady = _steady && _steady_state.update(_field, _grid, dt);
 
-            // Calculate Velocities U and V
-            _field.calculate_velocities(_grid);
-
-            // Storing the values in the VTK file
-            output_counter += dt;
-            if (output_counter >= _output_freq) {
-                output_vtk(timestep++, _rank);
-                output_counter = 0;
-                std::cout << "\n[" << static_cast<int>((t / _t_end) * 100) << "%"
-                          << " completed] Writing Data at t=" << t << "s"
-                          << "\n\n";
+        // Accumulate running statistics
+        if (_field.statistics_enabled() && t >= _statistics_start) {
+            _field.update_statistics(dt);
+            statistics_counter += dt;
+            if (_statistics_freq > 0 && statistics_counter >= _statistics_freq) {
+                output_statistics_vtk(statistics_output++, _rank);
+                statistics_counter = 0;
             }
+        }
+
+        // Storing the values in the VTK file
+        output_counter += dt;
+        if (output_counter >= _output_freq) {
+            output_vtk(timestep++, _rank);
+            output_counter = 0;
+            std::cout << "\n[" << static_cast<int>((t / _t_end) * 100) << "%"
+                      << " completed] Writing Data at t=" << t << "s"
+                      << "\n\n";
+        }
 
-            // Writing simulation data in a log file
+        // Storing the full resolution values in the VTK file
+        full_output_counter += dt;
+        if (_output_full_freq > 0 && full_output_counter >= _output_full_freq) {
+            output_vtk(full_timestep++, _rank, true);
+            full_output_counter = 0;
+        }
+
+        // Writing simulation data in a log file
+        if (!_binary_log) {
             output_file << std::left << "Simulation Time[s] = " << std::setw(7) << t
                         << "\tTime Step[s] = " << std::setw(7) << dt << "\tSOR Iterations = " << std::setw(3) << it
                         << "\tSOR Residual = " << std::setw(7) << res << "\n";
-            ;
+        }
 
-            // Printing info and checking for errors once in 5 runs of the loop
-            if (counter == 10) {
-                counter = 0;
-                std::cout << std::left << "Simulation Time[s] = " << std::setw(7) << t
-                          << "\tTime Step[s] = " << std::setw(7) << dt << "\tSOR Iterations = " << std::setw(3) << it
-                          << "\tSOR Residual = " << std::setw(7) << res << "\n";
+        // Printing info and checking for errors once in 5 runs of the loop
+        if (counter == 10) {
+            counter = 0;
+            std::cout << std::left << "Simulation Time[s] = " << std::setw(7) << t
+                      << "\tTime Step[s] = " << std::setw(7) << dt << "\tSOR Iterations = " << std::setw(3) << it
+                      << "\tSOR Residual = " << std::setw(7) << res << "\n";
+
+            if (check_err(_field, _grid.imax(), _grid.jmax())) exit(0); // Check for unphysical behaviour
+        }
+        counter++;
+        step++;
+
+        _timer.stop(step_phase::OUTPUT);
+
+        total_iterations += it;
+        max_iterations = std::max(max_iterations, it);
+        for (int k = 0; k < num_step_phases; ++k) {
+            phase_time[k] += _timer.elapsed(static_cast<step_phase>(k));
+        }
 
-                if (check_err(_field, _grid.imax(), _grid.jmax())) exit(0); // Check for unphysical behaviour
+        // Writing the timestep record to the binary step log
+        if (_binary_log) {
+            StepRecord record;
+            record.t = t;
+            record.dt = dt;
+            record.residual = res;
+            record.iterations = it;
+            for (int k = 0; k < num_step_phases; ++k) {
+                record.phase_time[k] = _timer.elapsed(static_cast<step_phase>(k));
             }
-            counter++;
+            step_log.write(record);
+        }
 
-            // Updating current time
-            t = t + dt;
+        // Updating current time
+        t = t + dt;
 
-            // Calculate Adaptive Time step
-            dt = _field.calculate_dt_e(_grid);
+        if (steady) {
+            std::cout << "\nSteady state reached at t=" << t << "s after " << step << " timesteps\n";
+            _steady_state.report(std::cout);
+            output_file << "Steady state reached at t=" << t << "s after " << step << " timesteps\n";
+            _steady_state.report(output_file);
+            break;
         }
+
+        // Calculate Adaptive Time step
+        dt = _energy_eq ? _field.calculate_dt_e(_grid) : _field.calculate_dt(_grid);
+    }
+
+    auto loop_end = std::chrono::steady_clock::now();
+    _timer.attach(nullptr);
+    if (_counters.is_open()) {
+        _counters.report(std::cout, phase_time, _grid.fluid_cells().size(), step);
+        _counters.report(output_file, phase_time, _grid.fluid_cells().size(), step);
+    }
+    if (!_bench_json.empty()) {
+        output_bench_json(step, total_iterations, max_iterations,
+                          std::chrono::duration<double>(loop_end - loop_start).count(), phase_time);
     }
 
     // Storing values at the last time step
     output_vtk(timestep, _rank);
+    if (_output_full_freq > 0) {
+        output_vtk(full_timestep, _rank, true);
+    }
+    _monitor.close();
+    step_log.close();
+    if (_field.statistics_enabled()) {
+        output_statistics_vtk(statistics_output, _rank);
+        std::cout << "Running statistics accumulated over " << _field.statistics_time() << "s\n";
+    }
+
+    if (_residual_history_freq > 0) {
+        _convergence.report(std::cout);
+        _convergence.report(output_file);
+    }
+    if (_omega_auto) {
+        _omega_tuner.report(std::cout);
+        _omega_tuner.report(output_file);
+        if (_omega_tuner.learned() && _omega_tuner.tuned()) {
+            OmegaTuner::store(_omega_cache, _omega_cache_key, _omega_tuner.omega());
+        }
+    }
+
+    if (!_trace_file.empty()) {
+        Trace::write(_trace_file);
+        std::cout << "Timeline written to " << _trace_file << "\n";
+    }
 
     std::cout << "\nSimulation Complete!\n";
     auto end = std::chrono::steady_clock::now();
-    cout << "Software Runtime:" << std::chrono::duration_cast<std::chrono::seconds>(end - start).count() << "s\n\n";
+    std::cout << "Software Runtime:" << std::chrono::duration_cast<std::chrono::seconds>(end - start).count() << "s\n\n";
     output_file << "Software Runtime:" << std::chrono::duration_cast<std::chrono::seconds>(end - start).count()
                 << "s\n\n";
     output_file.close();
 }
 
-void Case::output_vtk(int timestep, int my_rank) {
-    // Create a new structured grid
-    vtkSmartPointer<vtkStructuredGrid> structuredGrid = vtkSmartPointer<vtkStructuredGrid>::New();
-
-    // Create grid
-    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
-
-    double dx = _grid.dx();
-    double dy = _grid.dy();
-
-    double x = _grid.domain().imin * dx;
-    double y = _grid.domain().jmin * dy;
-
-    { y += dy; }
-    { x += dx; }
+void Case::run_grid_sequence(std::ofstream &output_file) {
+    std::unique_ptr<Grid> previous_grid;
+    Fields previous_field;
+
+    for (int level = _grid_sequence.levels(_grid); level >= 1; --level) {
+        const int factor = 1 << level;
+        Domain domain;
+        domain.dx = _grid.dx() * factor;
+        domain.dy = _grid.dy() * factor;
+        domain.domain_size_x = _grid.imax() / factor;
+        domain.domain_size_y = _grid.jmax() / factor;
+        build_domain(domain, domain.domain_size_x, domain.domain_size_y);
+
+        // The boundaries refer to the cells of the grid, which must not move
+        std::vector<std::vector<int>> geometry = GridSequence::coarsen(_grid, factor);
+        auto grid = std::make_unique<Grid>(geometry, domain);
+        Fields field(_field, *grid);
+        if (previous_grid) {
+            GridSequence::prolong(*previous_grid, previous_field, *grid, field);
+        } else {
+            GridSequence::restrict_fields(_grid, _field, *grid, field);
+        }
+        std::vector<std::unique_ptr<Boundary>> boundaries;
+        build_boundaries(*grid, boundaries);
+        Discretization discretization(grid->dx(), grid->dy(), _grid_sequence.gamma());
+        SOR solver(_grid_sequence.omega());
+        SteadyState steady_state(_grid_sequence.tolerance(), 10, false, _energy_eq);
+
+        double t = 0.0;
+        double dt = field.dt();
+        int step = 0;
+        int64_t iterations = 0;
+        bool steady = false;
+        bool diverged = false;
+        while (t < _grid_sequence.max_time() && !steady && !diverged) {
+            for (auto &boundary : boundaries) {
+                boundary->apply(field);
+                if (_energy_eq) boundary->apply_temperature(field);
+            }
+            if (_energy_eq) field.calculate_temperatures(*grid);
+            field.calculate_fluxes(*grid, _energy_eq);
+            field.calculate_rs(*grid);
 
-    double z = 0;
+            int it = 0;
+            double res = 1000.;
+            solver.initialize(field, *grid);
+            while (it <= _max_iter && res >= _tolerance) {
+                for (auto &boundary : boundaries) {
+                    boundary->apply_pressure(field);
+                }
+                res = solver.solve(field, *grid, boundaries);
+                it++;
+            }
+            iterations += it;
+            field.calculate_velocities(*grid);
 
-    for (int col = 0; col < _grid.domain().size_y + 1; col++) {
-        x = _grid.domain().imin * dx;
-        { x += dx; }
-        for (int row = 0; row < _grid.domain().size_x + 1; row++) {
-            points->InsertNextPoint(x, y, z);
-            x += dx;
+            steady = steady_state.update(field, *grid, dt);
+            diverged = !std::isfinite(res);
+            step++;
+            t = t + dt;
+            dt = _energy_eq ? field.calculate_dt_e(*grid) : field.calculate_dt(*grid);
         }
-        y += dy;
-    }
-
-    // Specify the dimensions of the grid
-    structuredGrid->SetDimensions(_grid.domain().size_x + 1, _grid.domain().size_y + 1, 1);
-    structuredGrid->SetPoints(points);
 
-    std::vector<vtkIdType> fixed_wall_cells;
-    for (int i = 1; i <= _grid.imax(); i++) {
-        for (int j = 1; j <= _grid.jmax(); j++) {
-            if (_grid.cell(i, j).wall_id() != 0) {
-                fixed_wall_cells.push_back(i - 1 + (j - 1) * _grid.imax());
-            }
+        std::ostringstream message;
+        message << "Grid sequencing on " << grid->imax() << " x " << grid->jmax() << " cells: "
+                << (steady ? "steady" : "stopped") << " at t=" << t << "s after " << step << " timesteps and "
+                << iterations << " SOR iterations\n";
+        std::cout << message.str();
+        output_file << message.str();
+        if (diverged) {
+            std::cout << "Grid sequencing diverged, the run starts from the initial values.\n";
+            output_file << "Grid sequencing diverged, the run starts from the initial values.\n";
+            previous_grid.reset();
+            break;
         }
-    }
 
-    for (auto t=0; t < fixed_wall_cells.size(); t++) {
-        structuredGrid->BlankCell(fixed_wall_cells.at(t));
+        previous_grid = std::move(grid);
+        previous_field = std::move(field);
     }
 
-    // Pressure Array
-    vtkDoubleArray *Pressure = vtkDoubleArray::New();
-    Pressure->SetName("pressure");
-    Pressure->SetNumberOfComponents(1);
+    if (previous_grid) {
+        GridSequence::prolong(*previous_grid, previous_field, _grid, _field);
+    }
+    _discretization = Discretization(_grid, _grid_sequence.gamma());
+}
 
-    // Velocity Array
-    vtkDoubleArray *Velocity = vtkDoubleArray::New();
-    Velocity->SetName("velocity");
-    Velocity->SetNumberOfComponents(3);
+void Case::output_vtk(int timestep, int my_rank, bool full) {
+    if (_no_output) return;
+    TraceScope scope(full ? "full vtk write" : "vtk write", "io", timestep);
 
-    // Temperature Array
-    vtkDoubleArray *Temperature = vtkDoubleArray::New();
-    Temperature->SetName("temperature");
-    Temperature->SetNumberOfComponents(1);
+    // Create Filename
+    std::string outputname = _dict_name + '/' + _case_name + (full ? "_full_" : "_") + std::to_string(my_rank) + "." +
+                             std::to_string(timestep);
 
-    // Print pressure and temperature from bottom to top
-    for (int j = 1; j < _grid.domain().size_y + 1; j++) {
-        for (int i = 1; i < _grid.domain().size_x + 1; i++) {
-            double pressure = _field.p(i, j);
-            Pressure->InsertNextTuple(&pressure);
-        }
+    if (!full && _output_error_bound > 0) {
+        SnapshotCompression::write(outputname + ".fcz", VTKOutput::snapshot(_grid, _field, _output_settings, _energy_eq),
+                                   _output_error_bound);
+        return;
     }
 
-    // Temp Velocity
-    float vel[3];
-    vel[2] = 0; // Set z component to 0
+    VTKOutput::write(outputname + ".vtk", _grid, _field, full ? OutputSettings() : _output_settings, _energy_eq);
+}
 
-    // Print Velocity from bottom to top
+void Case::output_statistics_vtk(int timestep, int my_rank) {
+    if (_no_output) return;
+    TraceScope scope("statistics write", "io", timestep);
 
-    for (int j = 0; j < _grid.domain().size_y + 1; j++) {
-        for (int i = 0; i < _grid.domain().size_x + 1; i++) {
-            vel[0] = (_field.u(i, j) + _field.u(i, j + 1)) * 0.5;
-            vel[1] = (_field.v(i, j) + _field.v(i + 1, j)) * 0.5;
-            Velocity->InsertNextTuple(vel);
-        }
-    }
+    std::string outputname = _dict_name + '/' + _case_name + "_statistics_" + std::to_string(my_rank) + "." +
+                             std::to_string(timestep) + ".vtk";
 
-    if (_energy_eq == true) {
-        // Print Temperature from bottom to top
-        for (int j = 1; j < _grid.domain().size_y + 1; j++) {
-            for (int i = 1; i < _grid.domain().size_x + 1; i++) {
-                double temperature = _field.t(i, j);
-                Temperature->InsertNextTuple(&temperature);
-            }
-        }
+    VTKOutput::write_statistics(outputname, _grid, _field, _energy_eq);
+}
 
-        // Add Temperature to Structured Grid
-        structuredGrid->GetCellData()->AddArray(Temperature);
+void Case::output_bench_json(int steps, int64_t iterations, int max_iterations, double loop_time,
+                             const std::array<double, num_step_phases> &phase_time) {
+    std::ofstream file(_bench_json);
+    if (!file.is_open()) {
+        std::cerr << "Benchmark summary " << _bench_json << " could not be opened." << std::endl;
+        return;
     }
 
-    // Add Pressure to Structured Grid
-    structuredGrid->GetCellData()->AddArray(Pressure);
-
-    // Add Velocity to Structured Grid
-    structuredGrid->GetPointData()->AddArray(Velocity);
+    // Peak resident set size, reported in kilobytes on Linux
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+
+    int n = std::max(steps, 1);
+    file << std::setprecision(9);
+    file << "{\n";
+    file << "  \"case\": \"" << _case_name << "\",\n";
+    file << "  \"cells\": " << _grid.imax() * _grid.jmax() << ",\n";
+    file << "  \"fluid_cells\": " << _grid.fluid_cells().size() << ",\n";
+    file << "  \"steps\": " << steps << ",\n";
+    file << "  \"time_per_step\": " << loop_time / n << ",\n";
+    file << "  \"sor_iterations\": " << iterations << ",\n";
+    file << "  \"sor_iterations_per_step\": " << static_cast<double>(iterations) / n << ",\n";
+    file << "  \"sor_iterations_max\": " << max_iterations << ",\n";
+    file << "  \"peak_rss_kb\": " << usage.ru_maxrss << ",\n";
+    file << "  \"phase_time_per_step\": {";
+    for (int k = 0; k < num_step_phases; ++k) {
+        file << (k ? ", " : "") << "\"" << step_phase_name(static_cast<step_phase>(k)) << "\": " << phase_time[k] / n;
+    }
+    file << "}\n";
+    file << "}\n";
+}
 
-    // Write Grid
-    vtkSmartPointer<vtkStructuredGridWriter> writer = vtkSmartPointer<vtkStructuredGridWriter>::New();
+std::string Case::omega_cache_key() const {
+    std::string geometry = _geom_name == "NONE" ? _geom_name : filesystem::path(_geom_name).filename().string();
 
-    // Create Filename
-    std::string outputname =
-        _dict_name + '/' + _case_name + "_" + std::to_string(my_rank) + "." + std::to_string(timestep) + ".vtk";
+    // FNV-1a over the fluid cell indices and the cell aspect ratio
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint64_t value) {
+        for (int byte = 0; byte < 8; ++byte) {
+            hash ^= (value >> (8 * byte)) & 0xff;
+            hash *= 1099511628211ull;
+        }
+    };
+    for (auto cell : _grid.fluid_cells()) {
+        mix(static_cast<uint64_t>(cell->i()) << 32 | static_cast<uint32_t>(cell->j()));
+    }
+    mix(static_cast<uint64_t>(std::llround(1e6 * _grid.dx() / _grid.dy())));
 
-    writer->SetFileName(outputname.c_str());
-    writer->SetInputData(structuredGrid);
-    writer->Write();
+    std::ostringstream key;
+    key << geometry << ':' << _grid.imax() << 'x' << _grid.jmax() << ':' << std::hex << hash;
+    return key.str();
 }
 
 void Case::build_domain(Domain &domain, int imax_domain, int jmax_domain) {
@@ -523,7 +997,7 @@ void Case::build_domain(Domain &domain, int imax_domain, int jmax_domain) {
     domain.size_y = jmax_domain;
 }
 
-bool Case::check_err(Fields &field, int imax, int jmax) {
+bool Case::check_err(const Fields &field, int imax, int jmax) {
     for (int i = 0; i < imax + 2; i++) {
         for (int j = 0; j < jmax + 2; j++) {
             if (std::isnan(field.u(i, j)) || std::isinf(field.u(i, j))) {
@@ -0,0 +1,444 @@
+#include "Compression.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <thread>
+
+/// Signature of a compressed snapshot, the last character is the format version
+static const char compression_magic[8] = {'F', 'L', 'C', 'H', 'C', 'M', 'P', '2'};
+
+/// Number of Huffman symbols, the last one escapes large residuals
+static const int num_symbols = 256;
+static const int escape_symbol = num_symbols - 1;
+
+/// Longest allowed Huffman code
+static const int max_code_length = 24;
+
+// Little helpers to serialise plain values into byte buffers
+template <typename T> static void put(std::vector<uint8_t> &buffer, const T &value) {
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&value);
+    buffer.insert(buffer.end(), bytes, bytes + sizeof(T));
+}
+
+template <typename T> static bool get(const std::vector<uint8_t> &buffer, size_t &pos, T &value) {
+    if (pos + sizeof(T) > buffer.size()) return false;
+    std::memcpy(&value, buffer.data() + pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+static void put_varint(std::vector<uint8_t> &buffer, uint64_t value) {
+    while (value >= 0x80) {
+        buffer.push_back(static_cast<uint8_t>(value) | 0x80);
+        value >>= 7;
+    }
+    buffer.push_back(static_cast<uint8_t>(value));
+}
+
+static bool get_varint(const std::vector<uint8_t> &buffer, size_t &pos, uint64_t &value) {
+    value = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (pos >= buffer.size()) return false;
+        uint8_t byte = buffer[pos++];
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) return true;
+    }
+    return false;
+}
+
+// Maps signed residuals to unsigned ones: 0, -1, 1, -2, 2, ... -> 0, 1, 2, 3, 4, ...
+static uint64_t zigzag(int64_t value) { return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63); }
+
+static int64_t unzigzag(uint64_t value) { return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1); }
+
+// Lorenzo predictor of the quantised value at (i, j) of a block
+static int64_t predict(const std::vector<int64_t> &q, int width, int i, int j) {
+    int64_t left = i > 0 ? q[j * width + i - 1] : 0;
+    int64_t below = j > 0 ? q[(j - 1) * width + i] : 0;
+    int64_t below_left = (i > 0 && j > 0) ? q[(j - 1) * width + i - 1] : 0;
+    return left + below - below_left;
+}
+
+// Huffman code lengths of the given symbol frequencies, limited to max_code_length
+static std::vector<uint8_t> code_lengths(std::vector<uint64_t> freq) {
+    std::vector<uint8_t> lengths(num_symbols, 0);
+
+    int used = std::count_if(freq.begin(), freq.end(), [](uint64_t f) { return f > 0; });
+    if (used == 0) return lengths;
+    if (used == 1) {
+        for (int s = 0; s < num_symbols; ++s) {
+            if (freq[s] > 0) lengths[s] = 1;
+        }
+        return lengths;
+    }
+
+    while (true) {
+        // Nodes 0..num_symbols-1 are leaves, the others are internal nodes
+        std::vector<int> parent(2 * num_symbols, -1);
+        using Node = std::pair<uint64_t, int>;
+        std::priority_queue<Node, std::vector<Node>, std::greater<Node>> heap;
+        for (int s = 0; s < num_symbols; ++s) {
+            if (freq[s] > 0) heap.push({freq[s], s});
+        }
+
+        int next = num_symbols;
+        while (heap.size() > 1) {
+            Node a = heap.top();
+            heap.pop();
+            Node b = heap.top();
+            heap.pop();
+            parent[a.second] = next;
+            parent[b.second] = next;
+            heap.push({a.first + b.first, next++});
+        }
+
+        int longest = 0;
+        for (int s = 0; s < num_symbols; ++s) {
+            if (freq[s] == 0) continue;
+            int depth = 0;
+            for (int node = s; parent[node] != -1; node = parent[node]) {
+                ++depth;
+            }
+            lengths[s] = depth;
+            longest = std::max(longest, depth);
+        }
+        if (longest <= max_code_length) break;
+
+        // Flatten the distribution until the longest code fits
+        for (auto &f : freq) {
+            if (f > 0) f = (f >> 1) | 1;
+        }
+    }
+    return lengths;
+}
+
+/**
+ * Canonical Huffman code of the given code lengths. Symbols are sorted by
+ * length and value, so that the code is fully described by the lengths.
+ */
+struct CanonicalCode {
+    std::vector<uint32_t> codes;
+    /// Symbols sorted by code length and value
+    std::vector<int> sorted;
+    /// First code of each length
+    std::vector<uint32_t> first;
+    /// Number of codes of each length
+    std::vector<int> count;
+    /// Index of the first symbol of each length in sorted
+    std::vector<int> offset;
+
+    explicit CanonicalCode(const std::vector<uint8_t> &lengths)
+        : codes(num_symbols, 0), first(max_code_length + 1, 0), count(max_code_length + 1, 0),
+          offset(max_code_length + 1, 0) {
+        for (int s = 0; s < num_symbols; ++s) {
+            if (lengths[s] > 0) {
+                sorted.push_back(s);
+                count[lengths[s]]++;
+            }
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), [&](int a, int b) { return lengths[a] < lengths[b]; });
+
+        uint32_t code = 0;
+        int index = 0;
+        for (int len = 1; len <= max_code_length; ++len) {
+            code <<= 1;
+            first[len] = code;
+            offset[len] = index;
+            for (int k = 0; k < count[len]; ++k) {
+                codes[sorted[index + k]] = code + k;
+            }
+            code += count[len];
+            index += count[len];
+        }
+    }
+};
+
+std::vector<uint8_t> SnapshotCompression::compress_block(const double *values, int stride, int width, int rows,
+                                                         double error_bound) {
+    const int n = width * rows;
+    const double scale = 0.5 / error_bound;
+
+    // Quantisation and prediction
+    std::vector<int64_t> q(n);
+    for (int k = 0; k < n; ++k) {
+        q[k] = std::llround(values[k * stride] * scale);
+    }
+
+    std::vector<uint64_t> residuals(n);
+    std::vector<uint64_t> freq(num_symbols, 0);
+    for (int j = 0; j < rows; ++j) {
+        for (int i = 0; i < width; ++i) {
+            uint64_t r = zigzag(q[j * width + i] - predict(q, width, i, j));
+            residuals[j * width + i] = r;
+            freq[std::min<uint64_t>(r, escape_symbol)]++;
+        }
+    }
+
+    // Entropy coding
+    std::vector<uint8_t> lengths = code_lengths(freq);
+    CanonicalCode code(lengths);
+
+    std::vector<uint8_t> bits;
+    std::vector<uint8_t> escapes;
+    uint64_t bit_buffer = 0;
+    int bit_count = 0;
+    for (uint64_t r : residuals) {
+        int symbol = std::min<uint64_t>(r, escape_symbol);
+        if (symbol == escape_symbol) {
+            put_varint(escapes, r - escape_symbol);
+        }
+        bit_buffer = (bit_buffer << lengths[symbol]) | code.codes[symbol];
+        bit_count += lengths[symbol];
+        while (bit_count >= 8) {
+            bits.push_back(static_cast<uint8_t>(bit_buffer >> (bit_count - 8)));
+            bit_count -= 8;
+        }
+    }
+    if (bit_count > 0) {
+        bits.push_back(static_cast<uint8_t>(bit_buffer << (8 - bit_count)));
+    }
+
+    std::vector<uint8_t> block;
+    block.insert(block.end(), lengths.begin(), lengths.end());
+    put(block, static_cast<uint64_t>(bits.size()));
+    block.insert(block.end(), bits.begin(), bits.end());
+    block.insert(block.end(), escapes.begin(), escapes.end());
+    return block;
+}
+
+bool SnapshotCompression::decompress_block(const std::vector<uint8_t> &block, double *values, int stride, int width,
+                                           int rows, double error_bound) {
+    const int n = width * rows;
+    if (block.size() < num_symbols) return false;
+
+    std::vector<uint8_t> lengths(block.begin(), block.begin() + num_symbols);
+    for (auto len : lengths) {
+        if (len > max_code_length) return false;
+    }
+    CanonicalCode code(lengths);
+
+    size_t pos = num_symbols;
+    uint64_t num_bytes;
+    if (!get(block, pos, num_bytes) || pos + num_bytes > block.size()) return false;
+    size_t bit_pos = pos * 8;
+    size_t bit_end = (pos + num_bytes) * 8;
+    size_t escape_pos = pos + num_bytes;
+
+    std::vector<int64_t> q(n);
+    for (int j = 0; j < rows; ++j) {
+        for (int i = 0; i < width; ++i) {
+            // Canonical decoding, one bit at a time
+            uint32_t value = 0;
+            int symbol = -1;
+            for (int len = 1; len <= max_code_length && bit_pos < bit_end; ++len) {
+                value = (value << 1) | ((block[bit_pos / 8] >> (7 - bit_pos % 8)) & 1);
+                ++bit_pos;
+                if (code.count[len] > 0 && value - code.first[len] < static_cast<uint32_t>(code.count[len])) {
+                    symbol = code.sorted[code.offset[len] + value - code.first[len]];
+                    break;
+                }
+            }
+            if (symbol < 0) return false;
+
+            uint64_t r = symbol;
+            if (symbol == escape_symbol) {
+                uint64_t extra;
+                if (!get_varint(block, escape_pos, extra)) return false;
+                r += extra;
+            }
+            q[j * width + i] = unzigzag(r) + predict(q, width, i, j);
+        }
+    }
+
+    for (int k = 0; k < n; ++k) {
+        values[k * stride] = q[k] * 2.0 * error_bound;
+    }
+    return true;
+}
+
+template <typename Task> void SnapshotCompression::run_parallel(int num_tasks, int num_threads, Task task) {
+    if (num_threads <= 0) {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    num_threads = std::min(num_threads, num_tasks);
+
+    std::atomic<int> next{0};
+    auto worker = [&]() {
+        for (int k = next++; k < num_tasks; k = next++) {
+            task(k);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads; ++t) {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+}
+
+void SnapshotCompression::write(const std::string &file_name, const Snapshot &snapshot, double error_bound,
+                                int rows_per_block, int num_threads) {
+    rows_per_block = std::max(rows_per_block, 1);
+
+    std::vector<uint8_t> buffer;
+    buffer.insert(buffer.end(), compression_magic, compression_magic + sizeof(compression_magic));
+
+    // Geometry, stored losslessly
+    put(buffer, static_cast<uint8_t>(snapshot.rectilinear));
+    put(buffer, static_cast<int32_t>(snapshot.x.size()));
+    put(buffer, static_cast<int32_t>(snapshot.y.size()));
+    for (double x : snapshot.x) put(buffer, x);
+    for (double y : snapshot.y) put(buffer, y);
+
+    put(buffer, static_cast<int32_t>(snapshot.blanked.size()));
+    int previous = 0;
+    for (int id : snapshot.blanked) {
+        put_varint(buffer, id - previous);
+        previous = id;
+    }
+
+    put(buffer, static_cast<int32_t>(snapshot.arrays.size()));
+    for (auto &array : snapshot.arrays) {
+        int width = array.point_data ? snapshot.x.size() : snapshot.cells_x();
+        int height = array.point_data ? snapshot.y.size() : snapshot.cells_y();
+        int num_blocks = (height + rows_per_block - 1) / rows_per_block;
+        int nc = array.num_components;
+
+        put(buffer, static_cast<uint8_t>(array.name.size()));
+        buffer.insert(buffer.end(), array.name.begin(), array.name.end());
+        put(buffer, static_cast<int32_t>(nc));
+        put(buffer, static_cast<uint8_t>(array.point_data));
+        put(buffer, error_bound);
+        put(buffer, static_cast<int32_t>(rows_per_block));
+
+        // Blocks of all components are compressed independently
+        std::vector<std::vector<uint8_t>> blocks(nc * num_blocks);
+        run_parallel(blocks.size(), num_threads, [&](int k) {
+            int c = k / num_blocks;
+            int b = k % num_blocks;
+            int rows = std::min(rows_per_block, height - b * rows_per_block);
+            blocks[k] = compress_block(&array.values[b * rows_per_block * width * nc + c], nc, width, rows,
+                                       error_bound);
+        });
+
+        for (auto &block : blocks) {
+            put(buffer, static_cast<uint64_t>(block.size()));
+            buffer.insert(buffer.end(), block.begin(), block.end());
+        }
+    }
+
+    std::ofstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Compressed snapshot " << file_name << " could not be opened." << std::endl;
+        return;
+    }
+    file.write(reinterpret_cast<const char *>(buffer.data()), buffer.size());
+}
+
+Snapshot SnapshotCompression::read(const std::string &file_name) {
+    Snapshot snapshot;
+
+    std::ifstream file(file_name, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Compressed snapshot " << file_name << " could not be opened." << std::endl;
+        return snapshot;
+    }
+    std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto corrupt = [&]() {
+        std::cerr << file_name << " is not a valid compressed snapshot." << std::endl;
+        return Snapshot();
+    };
+
+    // Version 1 precedes the rectilinear flag and is read as a structured grid
+    const size_t version = sizeof(compression_magic) - 1;
+    if (buffer.size() < sizeof(compression_magic) || std::memcmp(buffer.data(), compression_magic, version) != 0 ||
+        (buffer[version] != '1' && buffer[version] != compression_magic[version])) {
+        return corrupt();
+    }
+    size_t pos = sizeof(compression_magic);
+    if (buffer[version] != '1') {
+        uint8_t rectilinear;
+        if (!get(buffer, pos, rectilinear)) return corrupt();
+        snapshot.rectilinear = rectilinear;
+    }
+
+    int32_t nx, ny;
+    if (!get(buffer, pos, nx) || !get(buffer, pos, ny) || nx < 2 || ny < 2) return corrupt();
+    snapshot.x.resize(nx);
+    snapshot.y.resize(ny);
+    for (auto &x : snapshot.x) {
+        if (!get(buffer, pos, x)) return corrupt();
+    }
+    for (auto &y : snapshot.y) {
+        if (!get(buffer, pos, y)) return corrupt();
+    }
+
+    int32_t num_blanked;
+    if (!get(buffer, pos, num_blanked)) return corrupt();
+    int previous = 0;
+    for (int k = 0; k < num_blanked; ++k) {
+        uint64_t delta;
+        if (!get_varint(buffer, pos, delta)) return corrupt();
+        previous += delta;
+        snapshot.blanked.push_back(previous);
+    }
+
+    int32_t num_arrays;
+    if (!get(buffer, pos, num_arrays)) return corrupt();
+    for (int a = 0; a < num_arrays; ++a) {
+        SnapshotArray array;
+
+        uint8_t name_length;
+        if (!get(buffer, pos, name_length) || pos + name_length > buffer.size()) return corrupt();
+        array.name.assign(buffer.begin() + pos, buffer.begin() + pos + name_length);
+        pos += name_length;
+
+        int32_t nc, rows_per_block;
+        uint8_t point_data;
+        double error_bound;
+        if (!get(buffer, pos, nc) || !get(buffer, pos, point_data) || !get(buffer, pos, error_bound) ||
+            !get(buffer, pos, rows_per_block) || nc < 1 || rows_per_block < 1) {
+            return corrupt();
+        }
+        array.num_components = nc;
+        array.point_data = point_data;
+
+        int width = array.point_data ? snapshot.x.size() : snapshot.cells_x();
+        int height = array.point_data ? snapshot.y.size() : snapshot.cells_y();
+        int num_blocks = (height + rows_per_block - 1) / rows_per_block;
+        array.values.resize(static_cast<size_t>(width) * height * nc);
+
+        std::vector<std::vector<uint8_t>> blocks(nc * num_blocks);
+        for (auto &block : blocks) {
+            uint64_t size;
+            if (!get(buffer, pos, size) || pos + size > buffer.size()) return corrupt();
+            block.assign(buffer.begin() + pos, buffer.begin() + pos + size);
+            pos += size;
+        }
+
+        std::atomic<bool> valid{true};
+        run_parallel(blocks.size(), 0, [&](int k) {
+            int c = k / num_blocks;
+            int b = k % num_blocks;
+            int rows = std::min(rows_per_block, height - b * rows_per_block);
+            if (!decompress_block(blocks[k], &array.values[b * rows_per_block * width * nc + c], nc, width, rows,
+                                  error_bound)) {
+                valid = false;
+            }
+        });
+        if (!valid) return corrupt();
+
+        snapshot.arrays.push_back(std::move(array));
+    }
+
+    return snapshot;
+}
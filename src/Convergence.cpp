@@ -0,0 +1,234 @@
+#include "Convergence.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+/// Relative distance of the convergence factor to omega - 1 below which omega is taken as over-relaxed
+static const double overrelaxed_margin = 0.02;
+
+static double median(std::vector<double> values) {
+    if (values.empty()) return 0.0;
+    auto mid = values.begin() + values.size() / 2;
+    std::nth_element(values.begin(), mid, values.end());
+    return *mid;
+}
+
+void ConvergenceAnalysis::open_history(const std::string &file_name, int frequency) {
+    _history.open(file_name);
+    if (!_history.is_open()) {
+        std::cerr << "Residual history " << file_name << " could not be opened." << std::endl;
+        return;
+    }
+    _history_freq = std::max(frequency, 1);
+    _history << "step,t,iteration,residual\n" << std::setprecision(std::numeric_limits<double>::digits10);
+}
+
+void ConvergenceAnalysis::set_omega(double omega) { _omega = omega; }
+
+void ConvergenceAnalysis::set_sweeps(int sweeps) { _sweeps = std::max(sweeps, 1); }
+
+void ConvergenceAnalysis::begin_solve() { _residuals.clear(); }
+
+void ConvergenceAnalysis::add_residual(double residual) { _residuals.push_back(residual); }
+
+bool ConvergenceAnalysis::sampled(int k, int n) {
+    if (k <= 8 || k == n) return true;
+    // Geometric spacing, about 10 samples per decade of iterations
+    return std::floor(10.0 * std::log10(k)) != std::floor(10.0 * std::log10(k - 1));
+}
+
+void ConvergenceAnalysis::end_solve(int step, double t) {
+    const int n = _residuals.size();
+    ++_num_solves;
+    _num_iterations += n;
+
+    // Asymptotic factor over the second half of the iterations
+    _last_factor = 0.0;
+    if (n >= 3 && n * _sweeps >= min_iterations) {
+        int k0 = n / 2;
+        if (_residuals[k0] > 0.0 && _residuals[n - 1] > 0.0) {
+            _last_factor = std::pow(_residuals[n - 1] / _residuals[k0], 1.0 / ((n - 1 - k0) * _sweeps));
+        }
+    }
+
+    if (_last_factor > 0.0 && _last_factor < 1.0) {
+        _factors.push_back(_last_factor);
+        if (_omega > 1.0 && _last_factor < (_omega - 1.0) * (1.0 + overrelaxed_margin)) {
+            ++_num_overrelaxed;
+        } else {
+            double mu = jacobi_radius(_last_factor, _omega);
+            if (mu > 0.0) _mu.push_back(mu);
+        }
+    }
+
+    if (_history.is_open() && _history_solve++ % _history_freq == 0) {
+        for (int k = 1; k <= n; ++k) {
+            if (sampled(k, n)) {
+                _history << step << ',' << t << ',' << k << ',' << _residuals[k - 1] << '\n';
+            }
+        }
+    }
+}
+
+double ConvergenceAnalysis::last_factor() const { return _last_factor; }
+
+double ConvergenceAnalysis::jacobi_radius() const { return median(_mu); }
+
+double ConvergenceAnalysis::jacobi_radius(double factor, double omega) {
+    double mu2 = (factor + omega - 1.0) * (factor + omega - 1.0) / (factor * omega * omega);
+    if (!(mu2 > 0.0 && mu2 < 1.0)) return 0.0;
+    return std::sqrt(mu2);
+}
+
+double ConvergenceAnalysis::optimal_omega(double mu) { return 2.0 / (1.0 + std::sqrt(1.0 - mu * mu)); }
+
+void ConvergenceAnalysis::report(std::ostream &out) const {
+    out << "\nPressure solver convergence\n";
+    out << "Solves: " << _num_solves << ", iterations per solve: "
+        << (_num_solves ? static_cast<double>(_num_iterations) / _num_solves : 0.0)
+        << ", solves with at least " << min_iterations << " iterations: " << _factors.size() << "\n";
+
+    if (_factors.empty()) {
+        out << "Too few iterations per solve to estimate the convergence factor.\n";
+        return;
+    }
+
+    double rho = median(_factors);
+    out << "Asymptotic convergence factor (median): " << rho << " at omega = " << _omega << "\n";
+
+    if (_num_overrelaxed > static_cast<long>(_mu.size())) {
+        out << "The residual decays with about omega - 1 = " << _omega - 1.0
+            << ", so omega is at or above its optimum. Lower omg until the convergence factor "
+               "exceeds omega - 1 to let the optimum be estimated.\n";
+        return;
+    }
+    if (_mu.empty()) {
+        out << "The convergence factor does not determine the optimal relaxation factor.\n";
+        return;
+    }
+
+    double mu = median(_mu);
+    double omega_opt = optimal_omega(mu);
+    out << "Estimated Jacobi spectral radius: " << mu << "\n";
+    out << "Recommended relaxation factor: omg " << std::setprecision(3) << omega_opt << std::setprecision(6);
+    // The asymptotic rate is -ln(factor), the factor at the optimum being omega_opt - 1
+    if (omega_opt > 1.0 && omega_opt > _omega) {
+        out << ", asymptotic convergence rate " << std::setprecision(2) << std::log(omega_opt - 1.0) / std::log(rho)
+            << std::setprecision(6) << " times the current one";
+    }
+    out << "\n";
+}
+
+void OmegaTuner::start(double omega, bool tuned) {
+    _omega = omega;
+    _tuned = tuned;
+    _mu.clear();
+    _uninformative = 0;
+    _baseline_iterations = 0.0;
+    _window_iterations = 0;
+    _window_solves = 0;
+}
+
+void OmegaTuner::back_off() {
+    _omega = 1.0 + 0.75 * (_omega - 1.0);
+    _tuned = false;
+    _mu.clear();
+    _uninformative = 0;
+}
+
+bool OmegaTuner::update(double factor, int iterations) {
+    if (_tuned) {
+        _window_iterations += iterations;
+        if (++_window_solves < drift_window) return false;
+
+        double mean = static_cast<double>(_window_iterations) / _window_solves;
+        _window_iterations = 0;
+        _window_solves = 0;
+        if (_baseline_iterations == 0.0) {
+            _baseline_iterations = mean;
+        } else if (mean > drift_ratio * _baseline_iterations &&
+                   mean > _baseline_iterations + ConvergenceAnalysis::min_iterations) {
+            // Start below the optimum again, so that the factor is informative
+            ++_num_drifts;
+            back_off();
+            return true;
+        }
+        return false;
+    }
+
+    if (!(factor > 0.0 && factor < 1.0)) {
+        if (++_uninformative >= max_uninformative_solves) {
+            _tuned = true;
+            _baseline_iterations = 0.0;
+        }
+        return false;
+    }
+    if (_omega > 1.0 && factor < (_omega - 1.0) * (1.0 + overrelaxed_margin)) {
+        ++_num_back_offs;
+        back_off();
+        return true;
+    }
+    double mu = ConvergenceAnalysis::jacobi_radius(factor, _omega);
+    if (mu > 0.0) _mu.push_back(mu);
+    if (static_cast<int>(_mu.size()) < learn_solves) return false;
+
+    _last_mu = median(_mu);
+    _omega = ConvergenceAnalysis::optimal_omega(_last_mu);
+    ++_num_estimations;
+    start(_omega, true);
+    return true;
+}
+
+void OmegaTuner::report(std::ostream &out) const {
+    out << "\nRelaxation factor tuning\n";
+    out << "Final omega: " << std::setprecision(4) << _omega << std::setprecision(6);
+    if (_num_estimations > 0) {
+        out << ", from the Jacobi spectral radius estimate " << _last_mu;
+    } else if (!_tuned) {
+        out << ", estimation not finished";
+    } else {
+        out << ", not estimated during this run";
+    }
+    out << "\nEstimations: " << _num_estimations << ", lowered for over-relaxation: " << _num_back_offs
+        << ", iteration count drifts: " << _num_drifts << "\n";
+}
+
+double OmegaTuner::load(const std::string &file_name, const std::string &key) {
+    std::ifstream file(file_name);
+    std::string line;
+    double omega = 0.0;
+    while (std::getline(file, line)) {
+        std::istringstream entry(line);
+        std::string entry_key;
+        double entry_omega;
+        if (entry >> entry_key >> entry_omega && entry_key == key) omega = entry_omega;
+    }
+    return omega;
+}
+
+void OmegaTuner::store(const std::string &file_name, const std::string &key, double omega) {
+    std::vector<std::string> lines;
+    {
+        std::ifstream file(file_name);
+        std::string line;
+        while (std::getline(file, line)) {
+            std::istringstream entry(line);
+            std::string entry_key;
+            if (entry >> entry_key && entry_key != key) lines.push_back(line);
+        }
+    }
+
+    std::ofstream file(file_name);
+    if (!file.is_open()) {
+        std::cerr << "Relaxation factor cache " << file_name << " could not be written." << std::endl;
+        return;
+    }
+    for (auto &line : lines) {
+        file << line << '\n';
+    }
+    file << key << ' ' << std::setprecision(std::numeric_limits<double>::digits10) << omega << '\n';
+}
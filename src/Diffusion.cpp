@@ -0,0 +1,152 @@
+#include "Diffusion.hpp"
+#include "LinearAlgebra.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+
+/// Lines are distributed over the threads in chunks of at least this many
+static const int min_lines_per_chunk = 8;
+
+/// Index of the lines of a field in _lines
+static int lines_index(field_type type) {
+    switch (type) {
+    case field_type::U:
+        return 0;
+    case field_type::V:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+ImplicitDiffusion::ImplicitDiffusion(const Grid &grid, Fields &field,
+                                     const std::vector<std::unique_ptr<Boundary>> &boundaries, bool energy_eq)
+    : _imaxb(grid.imaxb()), _jmaxb(grid.jmaxb()), _dx(grid.dx()), _dy(grid.dy()) {
+    auto fluid = [&](int i, int j) {
+        return i >= 0 && i < _imaxb && j >= 0 && j < _jmaxb && grid.cell(i, j).type() == cell_type::FLUID;
+    };
+    std::array<std::vector<char>, 3> unknown;
+    for (auto &flags : unknown) {
+        flags.assign(_imaxb * _jmaxb, 0);
+    }
+    for (int j = 0; j < _jmaxb; ++j) {
+        for (int i = 0; i < _imaxb; ++i) {
+            // U and V of the faces between two fluid cells, T of the fluid cells
+            unknown[0][i + _imaxb * j] = fluid(i, j) && fluid(i + 1, j);
+            unknown[1][i + _imaxb * j] = fluid(i, j) && fluid(i, j + 1);
+            unknown[2][i + _imaxb * j] = fluid(i, j);
+        }
+    }
+
+    Matrix<double> saved_u = field.u_matrix();
+    Matrix<double> saved_v = field.v_matrix();
+    Matrix<double> saved_t = field.t_matrix();
+    const std::array<Matrix<double> *, 3> values{&field.u_matrix(), &field.v_matrix(), &field.t_matrix()};
+    for (int c = 0; c < (energy_eq ? 3 : 2); ++c) {
+        // The boundary values with all unknowns at zero and at one
+        std::array<Matrix<double>, 2> probe;
+        for (int level = 0; level < 2; ++level) {
+            double *data = values[c]->data();
+            for (int k = 0; k < _imaxb * _jmaxb; ++k) {
+                if (unknown[c][k]) data[k] = level;
+            }
+            for (auto &boundary : boundaries) {
+                if (c == 2) {
+                    boundary->apply_temperature(field);
+                } else {
+                    boundary->apply(field);
+                }
+            }
+            probe[level] = *values[c];
+        }
+        _lines[c] = find_lines(unknown[c], probe[0], probe[1]);
+    }
+    field.u_matrix() = saved_u;
+    field.v_matrix() = saved_v;
+    field.t_matrix() = saved_t;
+}
+
+ImplicitDiffusion::Lines ImplicitDiffusion::find_lines(const std::vector<char> &unknown, const Matrix<double> &zero,
+                                                       const Matrix<double> &one) const {
+    // A boundary value next to several unknowns is shared among them
+    auto weight = [&](int k) {
+        int neighbours = unknown[k - 1] + unknown[k + 1] + unknown[k - _imaxb] + unknown[k + _imaxb];
+        return (one.data()[k] - zero.data()[k]) / std::max(neighbours, 1);
+    };
+
+    Lines lines;
+    const int strides[2] = {1, _imaxb};
+    const int num_lines[2] = {_jmaxb, _imaxb};
+    const int line_size[2] = {_imaxb, _jmaxb};
+    for (int d = 0; d < 2; ++d) {
+        for (int line = 0; line < num_lines[d]; ++line) {
+            // Start of the grid line and stride along it
+            const int origin = d == 0 ? _imaxb * line : line;
+            int k = 0;
+            while (k < line_size[d]) {
+                if (!unknown[origin + strides[d] * k]) {
+                    ++k;
+                    continue;
+                }
+                int begin = k;
+                while (k < line_size[d] && unknown[origin + strides[d] * k]) {
+                    ++k;
+                }
+                int first = origin + strides[d] * begin;
+                int last = origin + strides[d] * (k - 1);
+                lines.direction[d].push_back(
+                    {first, k - begin, weight(first - strides[d]), weight(last + strides[d])});
+                lines.max_length = std::max(lines.max_length, k - begin);
+            }
+        }
+    }
+    return lines;
+}
+
+void ImplicitDiffusion::solve(field_type type, Matrix<double> &update, const Matrix<double> &current, double kdt,
+                              const Matrix<double> *pressure, double dt) const {
+    const Lines &lines = _lines[lines_index(type)];
+    const double r[2] = {kdt / (_dx * _dx), kdt / (_dy * _dy)};
+    const int strides[2] = {1, _imaxb};
+    double *values = update.data();
+    const double *previous = current.data();
+
+    // dt times the pressure gradient at the U or V faces, zero for T
+    const double *p = pressure ? pressure->data() : nullptr;
+    const int gradient_stride = type == field_type::V ? _imaxb : 1;
+    const double gradient_factor = type == field_type::V ? dt / _dy : dt / _dx;
+    auto gradient = [&](int idx) { return p ? gradient_factor * (p[idx + gradient_stride] - p[idx]) : 0.0; };
+
+    for (int d = 0; d < 2; ++d) {
+        const std::vector<Line> &direction = lines.direction[d];
+        const int stride = strides[d];
+        Parallel::parallel_for(
+            direction.size(),
+            [&](int begin, int end) {
+                std::vector<double> lower(lines.max_length, -r[d]);
+                std::vector<double> upper(lines.max_length, -r[d]);
+                std::vector<double> diag(lines.max_length);
+                std::vector<double> delta(lines.max_length);
+                std::vector<double> scratch(lines.max_length);
+                for (int l = begin; l < end; ++l) {
+                    const Line &line = direction[l];
+                    const int n = line.length;
+                    for (int k = 0; k < n; ++k) {
+                        int idx = line.first + stride * k;
+                        diag[k] = 1.0 + 2.0 * r[d];
+                        delta[k] = values[idx] - previous[idx] - (d == 0 ? gradient(idx) : 0.0);
+                    }
+                    // Changes beyond the ends follow the homogeneous boundary conditions
+                    diag[0] -= r[d] * line.lower_weight;
+                    diag[n - 1] -= r[d] * line.upper_weight;
+
+                    LinearAlgebra::thomas(n, lower.data(), diag.data(), upper.data(), delta.data(), scratch.data());
+                    for (int k = 0; k < n; ++k) {
+                        int idx = line.first + stride * k;
+                        values[idx] = previous[idx] + delta[k] + (d == 1 ? gradient(idx) : 0.0);
+                    }
+                }
+            },
+            min_lines_per_chunk);
+    }
+}
@@ -1,4 +1,5 @@
 #include "Discretization.hpp"
+#include "Grid.hpp"
 #include <cmath>
 #include <iostream>
 #include <math.h>
@@ -7,15 +8,54 @@
 double Discretization::_dx = 0.0;
 double Discretization::_dy = 0.0;
 double Discretization::_gamma = 0.0;
+bool Discretization::_stretched = false;
+std::vector<double> Discretization::_widths;
+std::vector<double> Discretization::_heights;
 
 Discretization::Discretization(double dx, double dy, double gamma) {
     _dx = dx;
     _dy = dy;
     _gamma = gamma;
+    _stretched = false;
+}
+
+Discretization::Discretization(const Grid &grid, double gamma) : Discretization(grid.dx(), grid.dy(), gamma) {
+    _stretched = grid.stretched();
+    _widths.clear();
+    _heights.clear();
+    if (!_stretched) return;
+    for (int i = 0; i < grid.imaxb(); ++i) {
+        _widths.push_back(grid.dx(i));
+    }
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        _heights.push_back(grid.dy(j));
+    }
+}
+
+// Interpolation to the face between two cells of the sizes h0 and h1
+static double face_value(double a0, double a1, double h0, double h1) { return (h1 * a0 + h0 * a1) / (h0 + h1); }
+
+// Donor-cell flux of the quantity a carried by the velocity w through a face, between the cells 0 and 1
+static double donor_flux(double w, double a0, double a1, double a_face, double gamma) {
+    return w * a_face + gamma * std::abs(w) * 0.5 * (a0 - a1);
 }
 
 // Convection in x direction
-double Discretization::convection_u(const Matrix<double> &U, const Matrix<double> &V, int i, int j) {
+template <bool stretched, typename M> double Discretization::convection_u(const M &U, const M &V, int i, int j) {
+    if constexpr (stretched) {
+        const double *dx = _widths.data();
+        const double *dy = _heights.data();
+        // U at the cell centres and V at the corners, interpolated by the distances
+        auto u2_flux = [&](int k) {
+            double uc = 0.5 * (U(k - 1, j) + U(k, j));
+            return donor_flux(uc, U(k - 1, j), U(k, j), uc, _gamma);
+        };
+        auto uv_flux = [&](int l) {
+            double vc = face_value(V(i, l), V(i + 1, l), dx[i], dx[i + 1]);
+            return donor_flux(vc, U(i, l), U(i, l + 1), face_value(U(i, l), U(i, l + 1), dy[l], dy[l + 1]), _gamma);
+        };
+        return (u2_flux(i + 1) - u2_flux(i)) / (0.5 * (dx[i] + dx[i + 1])) + (uv_flux(j) - uv_flux(j - 1)) / dy[j];
+    }
 
     double du2dx;
     double duvdy;
@@ -36,7 +76,20 @@ double Discretization::convection_u(const Matrix<double> &U, const Matrix<double
 }
 
 // Convection in y direction
-double Discretization::convection_v(const Matrix<double> &U, const Matrix<double> &V, int i, int j) {
+template <bool stretched, typename M> double Discretization::convection_v(const M &U, const M &V, int i, int j) {
+    if constexpr (stretched) {
+        const double *dx = _widths.data();
+        const double *dy = _heights.data();
+        auto uv_flux = [&](int k) {
+            double uc = face_value(U(k, j), U(k, j + 1), dy[j], dy[j + 1]);
+            return donor_flux(uc, V(k, j), V(k + 1, j), face_value(V(k, j), V(k + 1, j), dx[k], dx[k + 1]), _gamma);
+        };
+        auto v2_flux = [&](int l) {
+            double vc = 0.5 * (V(i, l - 1) + V(i, l));
+            return donor_flux(vc, V(i, l - 1), V(i, l), vc, _gamma);
+        };
+        return (uv_flux(i) - uv_flux(i - 1)) / dx[i] + (v2_flux(j + 1) - v2_flux(j)) / (0.5 * (dy[j] + dy[j + 1]));
+    }
 
     double duvdx;
     double dv2dy;
@@ -56,8 +109,21 @@ double Discretization::convection_v(const Matrix<double> &U, const Matrix<double
     return (duvdx + dv2dy);
 }
 
-double Discretization::convection_t(const Matrix<double> &U, const Matrix<double> &V, const Matrix<double> &T, int i,
-                                    int j) {
+template <bool stretched, typename M>
+double Discretization::convection_t(const M &U, const M &V, const M &T, int i, int j) {
+    if constexpr (stretched) {
+        const double *dx = _widths.data();
+        const double *dy = _heights.data();
+        auto x_flux = [&](int k) {
+            return donor_flux(U(k, j), T(k, j), T(k + 1, j), face_value(T(k, j), T(k + 1, j), dx[k], dx[k + 1]),
+                              _gamma);
+        };
+        auto y_flux = [&](int l) {
+            return donor_flux(V(i, l), T(i, l), T(i, l + 1), face_value(T(i, l), T(i, l + 1), dy[l], dy[l + 1]),
+                              _gamma);
+        };
+        return (x_flux(i) - x_flux(i - 1)) / dx[i] + (y_flux(j) - y_flux(j - 1)) / dy[j];
+    }
 
     double duTdx = U(i, j) * (T(i, j) + T(i + 1, j)) - U(i - 1, j) * (T(i - 1, j) + T(i, j));
     duTdx += _gamma * (std::abs(U(i, j)) * (T(i, j) - T(i + 1, j)) - 
@@ -72,13 +138,75 @@ double Discretization::convection_t(const Matrix<double> &U, const Matrix<double
     return (duTdx + dvTdy);
 }
 
-double Discretization::laplacian(const Matrix<double> &P, int i, int j) {
+template <bool stretched, typename M> double Discretization::laplacian(const M &P, int i, int j) {
+    if constexpr (stretched) {
+        const double *dx = _widths.data();
+        const double *dy = _heights.data();
+        return ((P(i + 1, j) - P(i, j)) / (0.5 * (dx[i] + dx[i + 1])) -
+                (P(i, j) - P(i - 1, j)) / (0.5 * (dx[i - 1] + dx[i]))) /
+                   dx[i] +
+               ((P(i, j + 1) - P(i, j)) / (0.5 * (dy[j] + dy[j + 1])) -
+                (P(i, j) - P(i, j - 1)) / (0.5 * (dy[j - 1] + dy[j]))) /
+                   dy[j];
+    }
     double result = (P(i + 1, j) - 2.0 * P(i, j) + P(i - 1, j)) / (_dx * _dx) +
                     (P(i, j + 1) - 2.0 * P(i, j) + P(i, j - 1)) / (_dy * _dy);
     return result;
 }
 
-double Discretization::sor_helper(const Matrix<double> &P, int i, int j) {
+template <bool stretched, typename M> double Discretization::laplacian_u(const M &U, int i, int j) {
+    if constexpr (!stretched) return laplacian<false>(U, i, j);
+    const double *dx = _widths.data();
+    const double *dy = _heights.data();
+    // U lives on the faces, the distances in x are the column widths
+    return ((U(i + 1, j) - U(i, j)) / dx[i + 1] - (U(i, j) - U(i - 1, j)) / dx[i]) / (0.5 * (dx[i] + dx[i + 1])) +
+           ((U(i, j + 1) - U(i, j)) / (0.5 * (dy[j] + dy[j + 1])) -
+            (U(i, j) - U(i, j - 1)) / (0.5 * (dy[j - 1] + dy[j]))) /
+               dy[j];
+}
+
+template <bool stretched, typename M> double Discretization::laplacian_v(const M &V, int i, int j) {
+    if constexpr (!stretched) return laplacian<false>(V, i, j);
+    const double *dx = _widths.data();
+    const double *dy = _heights.data();
+    return ((V(i + 1, j) - V(i, j)) / (0.5 * (dx[i] + dx[i + 1])) -
+            (V(i, j) - V(i - 1, j)) / (0.5 * (dx[i - 1] + dx[i]))) /
+               dx[i] +
+           ((V(i, j + 1) - V(i, j)) / dy[j + 1] - (V(i, j) - V(i, j - 1)) / dy[j]) / (0.5 * (dy[j] + dy[j + 1]));
+}
+
+template <bool stretched> double Discretization::sor_diagonal(int i, int j) {
+    if constexpr (!stretched) return 2.0 * (1.0 / (_dx * _dx) + 1.0 / (_dy * _dy));
+    const double *dx = _widths.data();
+    const double *dy = _heights.data();
+    return (1.0 / (0.5 * (dx[i] + dx[i + 1])) + 1.0 / (0.5 * (dx[i - 1] + dx[i]))) / dx[i] +
+           (1.0 / (0.5 * (dy[j] + dy[j + 1])) + 1.0 / (0.5 * (dy[j - 1] + dy[j]))) / dy[j];
+}
+
+template <bool stretched, typename M> double Discretization::sor_helper(const M &P, int i, int j) {
+    if constexpr (stretched) {
+        const double *dx = _widths.data();
+        const double *dy = _heights.data();
+        return (P(i + 1, j) / (0.5 * (dx[i] + dx[i + 1])) + P(i - 1, j) / (0.5 * (dx[i - 1] + dx[i]))) / dx[i] +
+               (P(i, j + 1) / (0.5 * (dy[j] + dy[j + 1])) + P(i, j - 1) / (0.5 * (dy[j - 1] + dy[j]))) / dy[j];
+    }
     double result = (P(i + 1, j) + P(i - 1, j)) / (_dx * _dx) + (P(i, j + 1) + P(i, j - 1)) / (_dy * _dy);
     return result;
 }
+
+// Stencils of uniform and stretched grids for dense and tiled storage
+#define INSTANTIATE_STENCILS(stretched, M)                                                                             \
+    template double Discretization::convection_u<stretched, M>(const M &, const M &, int, int);                        \
+    template double Discretization::convection_v<stretched, M>(const M &, const M &, int, int);                        \
+    template double Discretization::convection_t<stretched, M>(const M &, const M &, const M &, int, int);             \
+    template double Discretization::laplacian<stretched, M>(const M &, int, int);                                      \
+    template double Discretization::laplacian_u<stretched, M>(const M &, int, int);                                    \
+    template double Discretization::laplacian_v<stretched, M>(const M &, int, int);                                    \
+    template double Discretization::sor_helper<stretched, M>(const M &, int, int);
+
+INSTANTIATE_STENCILS(false, Matrix<double>)
+INSTANTIATE_STENCILS(true, Matrix<double>)
+INSTANTIATE_STENCILS(false, TileView<double>)
+INSTANTIATE_STENCILS(true, TileView<double>)
+template double Discretization::sor_diagonal<false>(int, int);
+template double Discretization::sor_diagonal<true>(int, int);
@@ -4,24 +4,27 @@
 #include <iostream>
 #include <math.h>
 
+#include "Diffusion.hpp"
+#include "Parallel.hpp"
+
 Fields::Fields(Grid &grid, double nu, double dt, double tau, double UI, double VI, double PI, double GX, double GY)
     : _nu(nu), _dt(dt), _tau(tau), _gx(GX), _gy(GY) {
 
-    _U = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
-    _V = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
-    _P = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
+    _U = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _V = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _P = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
 
-    _F = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
-    _G = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
-    _RS = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
+    _F = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _G = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _RS = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
 
     for (const auto &elem : grid.fluid_cells()) {
         int i = elem->i();
         int j = elem->j();
 
-        _U(i, j) = UI;
-        _V(i, j) = VI;
-        _P(i, j) = PI;
+        _U.get(i, j) = UI;
+        _V.get(i, j) = VI;
+        _P.get(i, j) = PI;
     }
 }
 
@@ -29,55 +32,111 @@ Fields::Fields(Grid &grid, double nu, double alpha, double beta, double dt, doub
                double TI, double GX, double GY)
     : _nu(nu), _alpha(alpha), _beta(beta), _dt(dt), _tau(tau), _gx(GX), _gy(GY) {
 
-    _U = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
-    _V = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
-    _P = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
-    _T = Matrix<double>(grid.imax() + 2, grid.jmax() + 2);
+    _U = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _V = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _P = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _T = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
 
-    _F = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
-    _G = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
-    _RS = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0);
+    _F = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _G = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _RS = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
 
     for (const auto &elem : grid.fluid_cells()) {
         int i = elem->i();
         int j = elem->j();
 
-        _U(i, j) = UI;
-        _V(i, j) = VI;
-        _P(i, j) = PI;
-        _T(i, j) = TI;
+        _U.get(i, j) = UI;
+        _V.get(i, j) = VI;
+        _P.get(i, j) = PI;
+        _T.get(i, j) = TI;
+    }
+}
+
+Fields::Fields(const Fields &other, Grid &grid)
+    : _nu(other._nu), _alpha(other._alpha), _beta(other._beta), _gx(other._gx), _gy(other._gy), _dt(other._dt),
+      _tau(other._tau) {
+
+    _U = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _V = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _P = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    if (other._T.size() > 0) {
+        _T = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
     }
+
+    _F = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _G = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    _RS = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
 }
 
 void Fields::calculate_temperatures(Grid &grid) {
 
     // Temporary matrix to store temperature
-    Matrix<double> T_new(grid.imax() + 2, grid.jmax() + 2, 0.0);
-
-    for (const auto &elem : grid.fluid_cells()) {
-        int i = elem->i();
-        int j = elem->j();
-        T_new(i, j) = _T(i, j) + _dt * (-Discretization::convection_t(_U, _V, _T, i, j) +
-                                        _alpha * Discretization::laplacian(_T, i, j));
-    }
+    Matrix<double> T_new(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+
+    _T.update_halos();
+    _U.update_halos();
+    _V.update_halos();
+    const auto &cells = grid.fluid_cells();
+    Discretization::run([&](auto stretched) {
+        grid.for_fluid_cells([&](auto block, int begin, int end) {
+            auto &&T_next = access(T_new, block);
+            auto &&T = access(_T, block);
+            auto &&U = access(_U, block);
+            auto &&V = access(_V, block);
+            for (int k = begin; k < end; ++k) {
+                int i = cells[k]->i();
+                int j = cells[k]->j();
+                T_next(i, j) = T(i, j) + _dt * (-Discretization::convection_t<stretched>(U, V, T, i, j) +
+                                                _alpha * Discretization::laplacian<stretched>(T, i, j));
+            }
+        });
+    });
+    T_new.invalidate_halos();
+    if (_time_scheme == time_scheme::AB2) extrapolate_rate(grid, T_new, _T, _rate_t);
+    if (_diffusion) _diffusion->solve(field_type::T, T_new, _T, _alpha * _dt);
     _T = T_new;
 }
 
 void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
-    for (const auto &elem : grid.fluid_cells()) {
-        int i = elem->i();
-        int j = elem->j();
-
-        _F(i, j) = _U(i, j) + _dt * ((_nu * Discretization::laplacian(_U, i, j)) -
-                                     Discretization::convection_u(_U, _V, i, j) + (1 - energy_eq) * _gx);
-
-        _G(i, j) = _V(i, j) + _dt * ((_nu * Discretization::laplacian(_V, i, j)) -
-                                     Discretization::convection_v(_U, _V, i, j) + (1 - energy_eq) * _gy);
-
-        if (energy_eq) {
-            _F(i, j) -= _gx * _dt * (_beta * 0.5 * (_T(i, j) + _T(i + 1, j)));
-            _G(i, j) -= _gy * _dt * (_beta * 0.5 * (_T(i, j) + _T(i, j + 1)));
-        }
+    _U.update_halos();
+    _V.update_halos();
+    _T.update_halos();
+    const auto &cells = grid.fluid_cells();
+    Discretization::run([&](auto stretched) {
+        grid.for_fluid_cells([&](auto block, int begin, int end) {
+            auto &&F = access(_F, block);
+            auto &&G = access(_G, block);
+            auto &&U = access(_U, block);
+            auto &&V = access(_V, block);
+            auto &&T = access(_T, block);
+            for (int k = begin; k < end; ++k) {
+                int i = cells[k]->i();
+                int j = cells[k]->j();
+
+                F(i, j) = U(i, j) + _dt * ((_nu * Discretization::laplacian_u<stretched>(U, i, j)) -
+                                           Discretization::convection_u<stretched>(U, V, i, j) + (1 - energy_eq) * _gx);
+
+                G(i, j) = V(i, j) + _dt * ((_nu * Discretization::laplacian_v<stretched>(V, i, j)) -
+                                           Discretization::convection_v<stretched>(U, V, i, j) + (1 - energy_eq) * _gy);
+
+                if (energy_eq) {
+                    F(i, j) -= _gx * _dt * (_beta * 0.5 * (T(i, j) + T(i + 1, j)));
+                    G(i, j) -= _gy * _dt * (_beta * 0.5 * (T(i, j) + T(i, j + 1)));
+                }
+            }
+        });
+    });
+    _F.invalidate_halos();
+    _G.invalidate_halos();
+    if (_time_scheme == time_scheme::AB2) {
+        extrapolate_rate(grid, _F, _U, _rate_u);
+        extrapolate_rate(grid, _G, _V, _rate_v);
+        // The temperatures of the step are computed before, with the same timestep size
+        _rate_dt = _dt;
+    }
+    if (_diffusion) {
+        _diffusion->solve(field_type::U, _F, _U, _nu * _dt, &_P, _dt);
+        _diffusion->solve(field_type::V, _G, _V, _nu * _dt, &_P, _dt);
     }
 
     // Applying Flux BC to fixed walls
@@ -87,57 +146,58 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
 
         if (elem->is_border(border_position::TOP)) {
             if (elem->is_border(border_position::RIGHT)) {
-                _F(i, j) = 0.0;
-                _G(i, j) = 0.0;
+                _F.get(i, j) = 0.0;
+                _G.get(i, j) = 0.0;
             }
 
             else if (elem->is_border(border_position::LEFT)) {
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                _G(i, j) = 0.0;
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                _G.get(i, j) = 0.0;
             }
 
             else if (elem->is_border(border_position::BOTTOM)) {
-                _G(i, j) = 0.0;
-                _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                _G.get(i, j) = 0.0;
+                _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
             }
 
             else {
-                _G(i, j) = _V(i, j);
+                _G.get(i, j) = _V.get(i, j);
             }
 
         }
 
         else if (elem->is_border(border_position::BOTTOM)) {
             if (elem->is_border(border_position::RIGHT)) {
-                _F(i, j) = 0.0;
-                _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                _F.get(i, j) = 0.0;
+                _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
             }
 
             else if (elem->is_border(border_position::LEFT)) {
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
             }
 
             else {
 
-                _G(i, elem->neighbour(border_position::BOTTOM)->j()) =
-                    _V(i, elem->neighbour(border_position::BOTTOM)->j());
+                _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) =
+                    _V.get(i, elem->neighbour(border_position::BOTTOM)->j());
             }
         }
 
         else if (elem->is_border(border_position::RIGHT)) {
             if (elem->is_border(border_position::LEFT)) {
-                _F(i, j) = 0.0;
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                _F.get(i, j) = 0.0;
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
             }
 
             else {
-                _F(i, j) = _U(i, j);
+                _F.get(i, j) = _U.get(i, j);
             }
         }
 
         else if (elem->is_border(border_position::LEFT)) {
-            _F(elem->neighbour(border_position::LEFT)->i(), j) = _U(elem->neighbour(border_position::LEFT)->i(), j);
+            _F.get(elem->neighbour(border_position::LEFT)->i(), j) =
+                _U.get(elem->neighbour(border_position::LEFT)->i(), j);
         }
     }
 
@@ -151,55 +211,56 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
 
             if (elem->is_border(border_position::TOP)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::BOTTOM)) {
-                    _G(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _G.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, j) = _V(i, j);
+                    _G.get(i, j) = _V.get(i, j);
                 }
             }
 
             else if (elem->is_border(border_position::BOTTOM)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) =
-                        _V(i, elem->neighbour(border_position::BOTTOM)->j());
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) =
+                        _V.get(i, elem->neighbour(border_position::BOTTOM)->j());
                 }
             }
 
             else if (elem->is_border(border_position::RIGHT)) {
                 if (elem->is_border(border_position::LEFT)) {
-                    _F(i, j) = 0.0;
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
                 }
 
                 else {
-                    _F(i, j) = _U(i, j);
+                    _F.get(i, j) = _U.get(i, j);
                 }
             }
 
             else if (elem->is_border(border_position::LEFT)) {
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = _U(elem->neighbour(border_position::LEFT)->i(), j);
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) =
+                    _U.get(elem->neighbour(border_position::LEFT)->i(), j);
             }
         }
 
@@ -212,56 +273,57 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
 
             if (elem->is_border(border_position::TOP)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::BOTTOM)) { // Need to verify
-                    _G(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _G.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, j) = _V(i, j);
+                    _G.get(i, j) = _V.get(i, j);
                 }
 
             }
 
             else if (elem->is_border(border_position::BOTTOM)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) =
-                        _V(i, elem->neighbour(border_position::BOTTOM)->j());
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) =
+                        _V.get(i, elem->neighbour(border_position::BOTTOM)->j());
                 }
             }
 
             else if (elem->is_border(border_position::RIGHT)) {
                 if (elem->is_border(border_position::LEFT)) {
-                    _F(i, j) = 0.0;
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
                 }
 
                 else {
-                    _F(i, j) = _U(i, j);
+                    _F.get(i, j) = _U.get(i, j);
                 }
             }
 
             else if (elem->is_border(border_position::LEFT)) {
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = _U(elem->neighbour(border_position::LEFT)->i(), j);
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) =
+                    _U.get(elem->neighbour(border_position::LEFT)->i(), j);
             }
         }
 
@@ -274,57 +336,58 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
 
             if (elem->is_border(border_position::TOP)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, j) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::BOTTOM)) {
-                    _G(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _G.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, j) = _V(i, j);
+                    _G.get(i, j) = _V.get(i, j);
                 }
 
             }
 
             else if (elem->is_border(border_position::BOTTOM)) {
                 if (elem->is_border(border_position::RIGHT)) {
-                    _F(i, j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else if (elem->is_border(border_position::LEFT)) {
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) = 0.0;
                 }
 
                 else {
-                    _G(i, elem->neighbour(border_position::BOTTOM)->j()) =
-                        _V(i, elem->neighbour(border_position::BOTTOM)->j());
+                    _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) =
+                        _V.get(i, elem->neighbour(border_position::BOTTOM)->j());
                 }
             }
 
             else if (elem->is_border(border_position::RIGHT)) {
                 if (elem->is_border(border_position::LEFT)) {
-                    _F(i, j) = 0.0;
-                    _F(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
+                    _F.get(i, j) = 0.0;
+                    _F.get(elem->neighbour(border_position::LEFT)->i(), j) = 0.0;
 
                 }
 
                 else {
-                    _F(i, j) = _U(i, j);
+                    _F.get(i, j) = _U.get(i, j);
                 }
             }
 
             else if (elem->is_border(border_position::LEFT)) {
-                _F(elem->neighbour(border_position::LEFT)->i(), j) = _U(elem->neighbour(border_position::LEFT)->i(), j);
+                _F.get(elem->neighbour(border_position::LEFT)->i(), j) =
+                    _U.get(elem->neighbour(border_position::LEFT)->i(), j);
             }
         }
     }
@@ -334,7 +397,8 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
         int i = elem->i();
         int j = elem->j();
 
-        _G(i, elem->neighbour(border_position::BOTTOM)->j()) = _V(i, elem->neighbour(border_position::BOTTOM)->j());
+        _G.get(i, elem->neighbour(border_position::BOTTOM)->j()) =
+            _V.get(i, elem->neighbour(border_position::BOTTOM)->j());
     }
 
     // Flux setup for inflow cells
@@ -342,7 +406,7 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
         int i = elem->i();
         int j = elem->j();
 
-        _F(i, j) = _U(i, j);
+        _F.get(i, j) = _U.get(i, j);
     }
 
     // Flux setup for outflow cells
@@ -350,87 +414,230 @@ void Fields::calculate_fluxes(Grid &grid, bool energy_eq) {
         int i = elem->i();
         int j = elem->j();
 
-        _F(elem->neighbour(border_position::LEFT)->i(), j) = _U(elem->neighbour(border_position::LEFT)->i(), j);
+        _F.get(elem->neighbour(border_position::LEFT)->i(), j) = _U.get(elem->neighbour(border_position::LEFT)->i(), j);
     }
 }
 
 void Fields::calculate_rs(Grid &grid) {
     auto idt = 1. / _dt;
-    for (const auto &elem : grid.fluid_cells()) {
-        int i = elem->i();
-        int j = elem->j();
-        rs(i, j) = idt * (((_F(i, j) - _F(elem->neighbour(border_position::LEFT)->i(), j)) / grid.dx()) +
-                          ((_G(i, j) - _G(i, elem->neighbour(border_position::BOTTOM)->j())) / grid.dy()));
-    }
+    _F.update_halos();
+    _G.update_halos();
+    const auto &cells = grid.fluid_cells();
+    Discretization::run([&](auto stretched) {
+        grid.for_fluid_cells([&](auto block, int begin, int end) {
+            auto &&RS = access(_RS, block);
+            auto &&F = access(_F, block);
+            auto &&G = access(_G, block);
+            for (int k = begin; k < end; ++k) {
+                const Cell *elem = cells[k];
+                int i = elem->i();
+                int j = elem->j();
+                double dx = stretched ? grid.dx(i) : grid.dx();
+                double dy = stretched ? grid.dy(j) : grid.dy();
+                RS(i, j) = idt * (((F(i, j) - F(elem->neighbour(border_position::LEFT)->i(), j)) / dx) +
+                                  ((G(i, j) - G(i, elem->neighbour(border_position::BOTTOM)->j())) / dy));
+            }
+        });
+    });
+    _RS.invalidate_halos();
 }
 
 void Fields::calculate_velocities(Grid &grid) {
 
-    for (const auto &elem : grid.fluid_cells()) {
-        int i = elem->i();
-        int j = elem->j();
+    _P.update_halos();
+    const auto &cells = grid.fluid_cells();
+    Discretization::run([&](auto stretched) {
+        grid.for_fluid_cells([&](auto block, int begin, int end) {
+            auto &&U = access(_U, block);
+            auto &&V = access(_V, block);
+            auto &&F = access(_F, block);
+            auto &&G = access(_G, block);
+            auto &&P = access(_P, block);
+            for (int k = begin; k < end; ++k) {
+                const Cell *elem = cells[k];
+                int i = elem->i();
+                int j = elem->j();
+                double dx = stretched ? grid.dx_centres(i) : grid.dx();
+                double dy = stretched ? grid.dy_centres(j) : grid.dy();
+
+                U(i, j) = F(i, j) - (_dt / dx) * (P(elem->neighbour(border_position::RIGHT)->i(), j) - P(i, j));
+
+                V(i, j) = G(i, j) - (_dt / dy) * (P(i, elem->neighbour(border_position::TOP)->j()) - P(i, j));
+            }
+        });
+    });
+    _U.invalidate_halos();
+    _V.invalidate_halos();
+}
 
-        _U(i, j) = _F(i, j) - (_dt / grid.dx()) * (_P(elem->neighbour(border_position::RIGHT)->i(), j) - _P(i, j));
+void Fields::extrapolate_rate(Grid &grid, Matrix<double> &update, const Matrix<double> &current,
+                              Matrix<double> &rate) const {
+    // Variable step AB2: rate^n + (dt_n / (2 dt_(n-1))) (rate^n - rate^(n-1))
+    const double ratio = _rate_dt > 0.0 ? 0.5 * _dt / _rate_dt : 0.0;
+    const double idt = 1.0 / _dt;
+    const auto &cells = grid.fluid_cells();
+    grid.for_fluid_cells([&](auto block, int begin, int end) {
+        auto &&next = access(update, block);
+        auto &&values = access(current, block);
+        auto &&rates = access(rate, block);
+        for (int k = begin; k < end; ++k) {
+            int i = cells[k]->i();
+            int j = cells[k]->j();
+            double value = values(i, j);
+            double current_rate = (next(i, j) - value) * idt;
+            next(i, j) = value + _dt * ((1.0 + ratio) * current_rate - ratio * rates(i, j));
+            rates(i, j) = current_rate;
+        }
+    });
+    update.invalidate_halos();
+    rate.invalidate_halos();
+}
 
-        _V(i, j) = _G(i, j) - (_dt / grid.dy()) * (_P(i, elem->neighbour(border_position::TOP)->j()) - _P(i, j));
-    }
+double Fields::max_abs(const Matrix<double> &A, Grid &grid) const {
+    const auto &cells = grid.fluid_cells();
+    return grid.max_fluid_cells([&](auto block, int begin, int end) {
+        auto &&values = access(A, block);
+        double max = 0.0;
+        for (int k = begin; k < end; ++k) {
+            int i = cells[k]->i();
+            int j = cells[k]->j();
+            max = std::max(max, std::fabs(values(i, j)));
+        }
+        return max;
+    });
 }
 
 double Fields::calculate_dt(Grid &grid) {
 
-    auto max_u = 0.0;
-    auto max_v = 0.0;
-
-    for (auto &elem : grid.fluid_cells()) {
-
-        int i = elem->i();
-        int j = elem->j();
-
-        if (std::fabs(_U(i, j)) > max_u) max_u = std::fabs(_U(i, j));
+    auto max_u = max_abs(_U, grid);
+    auto max_v = max_abs(_V, grid);
 
-        if (std::fabs(_V(i, j)) > max_v) max_v = std::fabs(_V(i, j));
-    }
-
-    auto factor1 = 1 / (1 / (grid.dx() * grid.dx()) + 1 / (grid.dy() * grid.dy()));
+    auto factor1 = 1 / (1 / (grid.min_dx() * grid.min_dx()) + 1 / (grid.min_dy() * grid.min_dy()));
     factor1 = factor1 / (2 * _nu);
-    auto factor2 = grid.dx() / max_u;
-    auto factor3 = grid.dy() / max_v;
+    auto factor2 = grid.min_dx() / max_u;
+    auto factor3 = grid.min_dy() / max_v;
+    // Implicit diffusion leaves the convective limit, bounded for a fluid at rest
+    if (_diffusion) {
+        _dt = std::min(_tau * std::min(factor2, factor3), _max_dt);
+        return _dt;
+    }
+    if (_time_scheme == time_scheme::AB2) {
+        _dt = std::min(std::min(_tau, ab2_diffusion_tau) * factor1, _tau * std::min(factor2, factor3));
+        return _dt;
+    }
     _dt = _tau * std::min(factor1, std::min(factor2, factor3));
     return _dt;
 }
 
 double Fields::calculate_dt_e(Grid &grid) {
 
-    auto max_u = 0.0;
-    auto max_v = 0.0;
-
-    for (auto &elem : grid.fluid_cells()) {
-
-        int i = elem->i();
-        int j = elem->j();
-
-        if (std::fabs(_U(i, j)) > max_u) max_u = std::fabs(_U(i, j));
-
-        if (std::fabs(_V(i, j)) > max_v) max_v = std::fabs(_V(i, j));
-    }
+    auto max_u = max_abs(_U, grid);
+    auto max_v = max_abs(_V, grid);
 
-    auto factor = 1 / (1 / (grid.dx() * grid.dx()) + 1 / (grid.dy() * grid.dy()));
+    auto factor = 1 / (1 / (grid.min_dx() * grid.min_dx()) + 1 / (grid.min_dy() * grid.min_dy()));
     auto factor1 = factor / (2 * _nu);
-    auto factor2 = grid.dx() / max_u;
-    auto factor3 = grid.dy() / max_v;
+    auto factor2 = grid.min_dx() / max_u;
+    auto factor3 = grid.min_dy() / max_v;
     auto factor4 = factor / (2 * _alpha);
+    if (_diffusion) {
+        _dt = std::min(_tau * std::min(factor2, factor3), _max_dt);
+        return _dt;
+    }
+    if (_time_scheme == time_scheme::AB2) {
+        _dt = std::min(std::min(_tau, ab2_diffusion_tau) * std::min(factor1, factor4),
+                       _tau * std::min(factor2, factor3));
+        return _dt;
+    }
     _dt = _tau * std::min(std::min(factor1, std::min(factor2, factor3)), factor4);
     return _dt;
 }
 
-double &Fields::p(int i, int j) { return _P(i, j); }
-double &Fields::u(int i, int j) { return _U(i, j); }
-double &Fields::v(int i, int j) { return _V(i, j); }
-double &Fields::t(int i, int j) { return _T(i, j); }
-double &Fields::f(int i, int j) { return _F(i, j); }
-double &Fields::g(int i, int j) { return _G(i, j); }
-double &Fields::rs(int i, int j) { return _RS(i, j); }
+void Fields::enable_statistics(Grid &grid, bool energy_eq) {
+    _num_statistics = energy_eq ? 4 : 3;
+    for (int k = 0; k < _num_statistics; ++k) {
+        _mean[k] = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+        _m2[k] = Matrix<double>(grid.imax() + 2, grid.jmax() + 2, 0.0, grid.tiles());
+    }
+    _statistics_weight = 0.0;
+}
+
+void Fields::update_statistics(double weight) {
+    if (weight <= 0.0) return;
+
+    _statistics_weight += weight;
+    const double ratio = weight / _statistics_weight;
+    const std::array<Matrix<double> *, 4> fields{&_U, &_V, &_P, &_T};
+
+    for (int k = 0; k < _num_statistics; ++k) {
+        const Matrix<double> &A = *fields[k];
+        Matrix<double> &mean = _mean[k];
+        Matrix<double> &m2 = _m2[k];
+        for (int j = 0; j < A.jmax(); ++j) {
+            for (int i = 0; i < A.imax(); ++i) {
+                if (!A.allocated(i, j)) continue;
+                double delta = A.get(i, j) - mean.get(i, j);
+                mean.get(i, j) += ratio * delta;
+                m2.get(i, j) += weight * delta * (A.get(i, j) - mean.get(i, j));
+            }
+        }
+    }
+}
+
+bool Fields::statistics_enabled() const { return _num_statistics > 0; }
+
+double Fields::statistics_time() const { return _statistics_weight; }
+
+double Fields::mean(field_type type, int i, int j) const { return _mean[static_cast<int>(type)].get(i, j); }
+
+double Fields::rms(field_type type, int i, int j) const {
+    if (_statistics_weight <= 0.0) return 0.0;
+    return std::sqrt(std::max(_m2[static_cast<int>(type)].get(i, j), 0.0) / _statistics_weight);
+}
+
+double &Fields::p(int i, int j) { return _P.get(i, j); }
+double &Fields::u(int i, int j) { return _U.get(i, j); }
+double &Fields::v(int i, int j) { return _V.get(i, j); }
+double &Fields::t(int i, int j) { return _T.get(i, j); }
+double &Fields::f(int i, int j) { return _F.get(i, j); }
+double &Fields::g(int i, int j) { return _G.get(i, j); }
+double &Fields::rs(int i, int j) { return _RS.get(i, j); }
+
+double Fields::p(int i, int j) const { return _P.get(i, j); }
+double Fields::u(int i, int j) const { return _U.get(i, j); }
+double Fields::v(int i, int j) const { return _V.get(i, j); }
+double Fields::t(int i, int j) const { return _T.get(i, j); }
 
 Matrix<double> &Fields::p_matrix() { return _P; }
 
+Matrix<double> &Fields::rs_matrix() { return _RS; }
+
+Matrix<double> &Fields::u_matrix() { return _U; }
+
+Matrix<double> &Fields::v_matrix() { return _V; }
+
+Matrix<double> &Fields::t_matrix() { return _T; }
+
+const Matrix<double> &Fields::p_matrix() const { return _P; }
+
+const Matrix<double> &Fields::u_matrix() const { return _U; }
+
+const Matrix<double> &Fields::v_matrix() const { return _V; }
+
+const Matrix<double> &Fields::t_matrix() const { return _T; }
+
+void Fields::set_diffusion(const ImplicitDiffusion *diffusion, double max_dt) {
+    _diffusion = diffusion;
+    _max_dt = max_dt;
+}
+
+void Fields::set_time_scheme(time_scheme scheme) {
+    _time_scheme = scheme;
+    _rate_u = Matrix<double>(_U.imax(), _U.jmax(), 0.0, _U.tiles());
+    _rate_v = Matrix<double>(_V.imax(), _V.jmax(), 0.0, _V.tiles());
+    _rate_t = Matrix<double>(_T.imax(), _T.jmax(), 0.0, _T.tiles());
+    _rate_dt = 0.0;
+}
+
 double Fields::dt() const { return _dt; }
+
+double Fields::alpha() const { return _alpha; }
@@ -2,6 +2,7 @@
 #include "Enums.hpp"
 
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
 #include <sstream>
@@ -23,6 +24,15 @@ Grid::Grid(std::string geom_name, Domain &domain) {
     }
 }
 
+Grid::Grid(std::vector<std::vector<int>> &geometry_data, Domain &domain) {
+
+    _domain = domain;
+
+    _cells = Matrix<Cell>(_domain.size_x + 2, _domain.size_y + 2);
+
+    assign_cell_types(geometry_data);
+}
+
 void Grid::build_lid_driven_cavity() {
     std::vector<std::vector<int>> geometry_data(_domain.domain_size_x + 2,
                                                 std::vector<int>(_domain.domain_size_y + 2, 0));
@@ -268,6 +278,99 @@ double Grid::dx() const { return _domain.dx; }
 
 double Grid::dy() const { return _domain.dy; }
 
+double Grid::dx(int i) const { return _stretched ? _widths[i] : _domain.dx; }
+
+double Grid::dy(int j) const { return _stretched ? _heights[j] : _domain.dy; }
+
+double Grid::x_face(int i) const { return _stretched ? _x_faces[i] : i * _domain.dx; }
+
+double Grid::y_face(int j) const { return _stretched ? _y_faces[j] : j * _domain.dy; }
+
+double Grid::min_dx() const {
+    return _stretched ? *std::min_element(_widths.begin(), _widths.end()) : _domain.dx;
+}
+
+double Grid::min_dy() const {
+    return _stretched ? *std::min_element(_heights.begin(), _heights.end()) : _domain.dy;
+}
+
+void Grid::set_spacing(const std::vector<double> &widths, const std::vector<double> &heights) {
+    auto with_ghosts = [](const std::vector<double> &sizes) {
+        std::vector<double> result(sizes.size() + 2);
+        std::copy(sizes.begin(), sizes.end(), result.begin() + 1);
+        result.front() = sizes.front();
+        result.back() = sizes.back();
+        return result;
+    };
+    // Face k is the right (top) face of cell k, face 0 the boundary of the domain
+    auto faces = [](const std::vector<double> &sizes) {
+        std::vector<double> result(sizes.size());
+        result[0] = 0.0;
+        for (std::size_t k = 1; k < sizes.size(); ++k) {
+            result[k] = result[k - 1] + sizes[k];
+        }
+        return result;
+    };
+    _stretched = true;
+    _widths = with_ghosts(widths);
+    _heights = with_ghosts(heights);
+    _x_faces = faces(_widths);
+    _y_faces = faces(_heights);
+}
+
+std::vector<double> Grid::stretching(const std::string &type, double parameter, double length, int cells) {
+    std::vector<double> sizes(cells, length / cells);
+    if (type == "tanh" && parameter > 0.0) {
+        auto face = [&](int k) {
+            return 0.5 * length * (1.0 + std::tanh(parameter * (2.0 * k / cells - 1.0)) / std::tanh(parameter));
+        };
+        for (int k = 0; k < cells; ++k) {
+            sizes[k] = face(k + 1) - face(k);
+        }
+    } else if (type == "geometric" && parameter > 0.0) {
+        double sum = 0.0;
+        for (int k = 0; k < cells; ++k) {
+            sizes[k] = std::pow(parameter, std::min(k, cells - 1 - k));
+            sum += sizes[k];
+        }
+        for (auto &size : sizes) {
+            size *= length / sum;
+        }
+    }
+    return sizes;
+}
+
+void Grid::set_tiling() {
+    const int imaxb = this->imaxb();
+    const int jmaxb = this->jmaxb();
+    auto tile = [](int i, int j, int tiles_x) { return (i >> TileMap::shift) + tiles_x * (j >> TileMap::shift); };
+
+    const int tiles_x = (imaxb + TileMap::tile_size - 1) >> TileMap::shift;
+    const int tiles_y = (jmaxb + TileMap::tile_size - 1) >> TileMap::shift;
+    std::vector<bool> active(tiles_x * tiles_y, false);
+    // The corner boundary conditions also set values of the cells diagonal to the fluid
+    for (auto cell : _fluid_cells) {
+        for (int j = cell->j() - 1; j <= cell->j() + 1; ++j) {
+            for (int i = cell->i() - 1; i <= cell->i() + 1; ++i) {
+                if (i >= 0 && j >= 0 && i < imaxb && j < jmaxb) active[tile(i, j, tiles_x)] = true;
+            }
+        }
+    }
+    _tiles = std::make_shared<const TileMap>(imaxb, jmaxb, active);
+
+    // Tiles are stored in lexicographic order, so sorting by tile keeps the order within a tile
+    std::stable_sort(_fluid_cells.begin(), _fluid_cells.end(), [&](const Cell *a, const Cell *b) {
+        return tile(a->i(), a->j(), tiles_x) < tile(b->i(), b->j(), tiles_x);
+    });
+    _tile_cells.assign(_tiles->active.size() + 1, 0);
+    for (auto cell : _fluid_cells) {
+        ++_tile_cells[_tiles->slot(cell->i(), cell->j()) + 1];
+    }
+    for (std::size_t slot = 0; slot < _tiles->active.size(); ++slot) {
+        _tile_cells[slot + 1] += _tile_cells[slot];
+    }
+}
+
 const Domain &Grid::domain() const { return _domain; }
 
 const std::vector<Cell *> &Grid::fluid_cells() const { return _fluid_cells; }
@@ -0,0 +1,183 @@
+#include "GridSequence.hpp"
+#include "Enums.hpp"
+
+#include <cmath>
+#include <map>
+
+GridSequence::GridSequence(int levels, double tolerance, double max_time, double omega, double gamma)
+    : _levels(levels), _tolerance(tolerance), _max_time(max_time), _omega(omega), _gamma(gamma) {}
+
+int GridSequence::levels(const Grid &grid) const {
+    int levels = 0;
+    while (levels < _levels) {
+        int factor = 2 << levels;
+        if (grid.imax() % factor != 0 || grid.jmax() % factor != 0 || grid.imax() / factor < min_cells ||
+            grid.jmax() / factor < min_cells) {
+            break;
+        }
+        ++levels;
+    }
+    return levels;
+}
+
+std::vector<std::vector<int>> GridSequence::coarsen(const Grid &grid, int factor) {
+    const int imax = grid.imax() / factor;
+    const int jmax = grid.jmax() / factor;
+
+    // First and last fine index covered by a coarse index, the ghost layers cover the fine ghost layers
+    auto first = [factor](int k, int kmax, int fine_kmax) {
+        return k == 0 ? 0 : (k == kmax + 1 ? fine_kmax + 1 : factor * (k - 1) + 1);
+    };
+    auto last = [factor](int k, int kmax, int fine_kmax) {
+        return k == 0 ? 0 : (k == kmax + 1 ? fine_kmax + 1 : factor * k);
+    };
+
+    std::vector<std::vector<int>> geometry(imax + 2, std::vector<int>(jmax + 2, 0));
+    for (int i = 0; i < imax + 2; ++i) {
+        for (int j = 0; j < jmax + 2; ++j) {
+            // Most frequent obstacle id among the fine cells, fluid if there is none
+            std::map<int, int> count;
+            for (int fi = first(i, imax, grid.imax()); fi <= last(i, imax, grid.imax()); ++fi) {
+                for (int fj = first(j, jmax, grid.jmax()); fj <= last(j, jmax, grid.jmax()); ++fj) {
+                    Cell cell = grid.cell(fi, fj);
+                    if (cell.type() != cell_type::FLUID) ++count[cell.wall_id()];
+                }
+            }
+            int most = 0;
+            for (const auto &entry : count) {
+                if (entry.second > most) {
+                    most = entry.second;
+                    geometry[i][j] = entry.first;
+                }
+            }
+        }
+    }
+
+    // Obstacle cells with more than two fluid neighbours become fluid cells
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i <= imax; ++i) {
+            for (int j = 1; j <= jmax; ++j) {
+                if (geometry[i][j] == 0) continue;
+                int fluid = (geometry[i - 1][j] == 0) + (geometry[i + 1][j] == 0) + (geometry[i][j - 1] == 0) +
+                            (geometry[i][j + 1] == 0);
+                if (fluid > 2) {
+                    geometry[i][j] = 0;
+                    changed = true;
+                }
+            }
+        }
+    }
+    return geometry;
+}
+
+void GridSequence::restrict_fields(const Grid &fine_grid, Fields &fine, const Grid &coarse_grid, Fields &coarse) {
+    const int factor = fine_grid.imax() / coarse_grid.imax();
+    const bool temperature = coarse.t_matrix().size() > 0;
+    auto fluid = [&](int i, int j) { return fine_grid.cell(i, j).type() == cell_type::FLUID; };
+
+    for (int i = 0; i <= coarse_grid.imax(); ++i) {
+        for (int j = 1; j <= coarse_grid.jmax(); ++j) {
+            // Cell averages of P and T over the fluid cells, face averages of U and V over the coarse faces
+            double p = 0.0, t = 0.0, u = 0.0;
+            int cells = 0;
+            for (int k = 0; k < factor; ++k) {
+                for (int l = 0; l < factor; ++l) {
+                    int fi = factor * (i - 1) + 1 + k;
+                    int fj = factor * (j - 1) + 1 + l;
+                    if (i > 0 && fluid(fi, fj)) {
+                        p += fine.p(fi, fj);
+                        if (temperature) t += fine.t(fi, fj);
+                        ++cells;
+                    }
+                }
+                u += fine.u(factor * i, factor * (j - 1) + 1 + k);
+            }
+            if (cells > 0) {
+                coarse.p(i, j) = p / cells;
+                if (temperature) coarse.t(i, j) = t / cells;
+            }
+            coarse.u(i, j) = u / factor;
+        }
+    }
+    for (int i = 1; i <= coarse_grid.imax(); ++i) {
+        for (int j = 0; j <= coarse_grid.jmax(); ++j) {
+            double v = 0.0;
+            for (int k = 0; k < factor; ++k) {
+                v += fine.v(factor * (i - 1) + 1 + k, factor * j);
+            }
+            coarse.v(i, j) = v / factor;
+        }
+    }
+}
+
+/**
+ * @brief Bilinear interpolation at fractional indices from the valid values
+ *
+ * The weights of invalid values are left out and the others rescaled. The
+ * value is kept if none of the four values is valid.
+ */
+template <typename Valid>
+static void interpolate(const Matrix<double> &A, Valid valid, double x, double y, double &value) {
+    const int i0 = static_cast<int>(std::floor(x));
+    const int j0 = static_cast<int>(std::floor(y));
+    const double wx = x - i0;
+    const double wy = y - j0;
+    double sum = 0.0;
+    double weight = 0.0;
+    for (int di = 0; di < 2; ++di) {
+        for (int dj = 0; dj < 2; ++dj) {
+            int i = i0 + di;
+            int j = j0 + dj;
+            double w = (di ? wx : 1.0 - wx) * (dj ? wy : 1.0 - wy);
+            if (w <= 0.0 || i < 0 || j < 0 || i >= A.imax() || j >= A.jmax() || !valid(i, j)) continue;
+            sum += w * A(i, j);
+            weight += w;
+        }
+    }
+    if (weight > 0.0) value = sum / weight;
+}
+
+void GridSequence::prolong(const Grid &coarse_grid, Fields &coarse, const Grid &fine_grid, Fields &fine) {
+    const double factor = static_cast<double>(fine_grid.imax()) / coarse_grid.imax();
+    const bool temperature = fine.t_matrix().size() > 0;
+    const int imaxb = coarse_grid.imaxb();
+    const int jmaxb = coarse_grid.jmaxb();
+
+    auto coarse_fluid = [&](int i, int j) {
+        return i >= 0 && j >= 0 && i < imaxb && j < jmaxb && coarse_grid.cell(i, j).type() == cell_type::FLUID;
+    };
+    // Fluid cells and the boundary cells next to them, whose velocities are set by the boundary conditions
+    auto touches_fluid = [&](int i, int j) {
+        return coarse_fluid(i, j) || coarse_fluid(i - 1, j) || coarse_fluid(i + 1, j) || coarse_fluid(i, j - 1) ||
+               coarse_fluid(i, j + 1);
+    };
+    auto valid_u = [&](int i, int j) { return touches_fluid(i, j) && touches_fluid(i + 1, j); };
+    auto valid_v = [&](int i, int j) { return touches_fluid(i, j) && touches_fluid(i, j + 1); };
+    auto fine_fluid = [&](int i, int j) {
+        return i >= 0 && j >= 0 && i < fine_grid.imaxb() && j < fine_grid.jmaxb() &&
+               fine_grid.cell(i, j).type() == cell_type::FLUID;
+    };
+
+    // Coarse index of a fine cell centre and of a fine face
+    auto centre = [factor](int k) { return (k - 0.5) / factor + 0.5; };
+    auto face = [factor](int k) { return k / factor; };
+
+    for (int i = 0; i < fine_grid.imaxb(); ++i) {
+        for (int j = 0; j < fine_grid.jmaxb(); ++j) {
+            if (fine_fluid(i, j)) {
+                interpolate(coarse.p_matrix(), coarse_fluid, centre(i), centre(j), fine.p(i, j));
+                if (temperature) {
+                    interpolate(coarse.t_matrix(), coarse_fluid, centre(i), centre(j), fine.t(i, j));
+                }
+            }
+            if (fine_fluid(i, j) || fine_fluid(i + 1, j)) {
+                interpolate(coarse.u_matrix(), valid_u, face(i), centre(j), fine.u(i, j));
+            }
+            if (fine_fluid(i, j) || fine_fluid(i, j + 1)) {
+                interpolate(coarse.v_matrix(), valid_v, centre(i), face(j), fine.v(i, j));
+            }
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#include "LinearAlgebra.hpp"
+
+#include <algorithm>
+
+namespace LinearAlgebra {
+
+void thomas(int n, const double *lower, const double *diag, const double *upper, double *rhs, double *scratch) {
+    double inv = 1.0 / diag[0];
+    scratch[0] = upper[0] * inv;
+    rhs[0] *= inv;
+    for (int k = 1; k < n; ++k) {
+        inv = 1.0 / (diag[k] - lower[k] * scratch[k - 1]);
+        scratch[k] = upper[k] * inv;
+        rhs[k] = (rhs[k] - lower[k] * rhs[k - 1]) * inv;
+    }
+    for (int k = n - 2; k >= 0; --k) {
+        rhs[k] -= scratch[k] * rhs[k + 1];
+    }
+}
+
+TridiagonalSystems::TridiagonalSystems(double lower, double upper) : _lower(lower), _upper_coeff(upper) {}
+
+int TridiagonalSystems::add(const std::vector<double> &diag) {
+    int offset = _upper.size();
+    double previous = 0.0;
+    for (double d : diag) {
+        _inv_diag.push_back(1.0 / (d - _lower * previous));
+        _upper.push_back(_upper_coeff * _inv_diag.back());
+        previous = _upper.back();
+    }
+    return offset;
+}
+
+void TridiagonalSystems::solve(int offset, int n, double *rhs) const {
+    const double *upper = _upper.data() + offset;
+    const double *inv_diag = _inv_diag.data() + offset;
+    rhs[0] *= inv_diag[0];
+    for (int k = 1; k < n; ++k) {
+        rhs[k] = (rhs[k] - _lower * rhs[k - 1]) * inv_diag[k];
+    }
+    for (int k = n - 2; k >= 0; --k) {
+        rhs[k] -= upper[k] * rhs[k + 1];
+    }
+}
+
+void CsrMatrix::multiply(const double *x, double *y) const {
+    for (int i = 0; i < rows; ++i) {
+        double sum = 0.0;
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+            sum += val[k] * x[col[k]];
+        }
+        y[i] = sum;
+    }
+}
+
+CsrMatrix CsrMatrix::transpose() const {
+    CsrMatrix t;
+    t.rows = cols;
+    t.cols = rows;
+    t.row_ptr.assign(cols + 1, 0);
+    for (int c : col) {
+        ++t.row_ptr[c + 1];
+    }
+    for (int i = 0; i < cols; ++i) {
+        t.row_ptr[i + 1] += t.row_ptr[i];
+    }
+    t.col.resize(col.size());
+    t.val.resize(val.size());
+    // Rows are visited in order, so the columns of the transpose stay sorted
+    std::vector<int> next(t.row_ptr.begin(), t.row_ptr.end() - 1);
+    for (int i = 0; i < rows; ++i) {
+        for (int k = row_ptr[i]; k < row_ptr[i + 1]; ++k) {
+            int pos = next[col[k]]++;
+            t.col[pos] = i;
+            t.val[pos] = val[k];
+        }
+    }
+    return t;
+}
+
+CsrMatrix CsrMatrix::product(const CsrMatrix &a, const CsrMatrix &b) {
+    CsrMatrix c;
+    c.rows = a.rows;
+    c.cols = b.cols;
+    c.row_ptr.reserve(a.rows + 1);
+
+    // Row-by-row accumulation into a dense row with a list of its occupied columns
+    std::vector<double> row(b.cols, 0.0);
+    std::vector<int> position(b.cols, -1);
+    std::vector<int> columns;
+    for (int i = 0; i < a.rows; ++i) {
+        columns.clear();
+        for (int ka = a.row_ptr[i]; ka < a.row_ptr[i + 1]; ++ka) {
+            int j = a.col[ka];
+            for (int kb = b.row_ptr[j]; kb < b.row_ptr[j + 1]; ++kb) {
+                int m = b.col[kb];
+                if (position[m] < 0) {
+                    position[m] = columns.size();
+                    columns.push_back(m);
+                    row[m] = 0.0;
+                }
+                row[m] += a.val[ka] * b.val[kb];
+            }
+        }
+        std::sort(columns.begin(), columns.end());
+        for (int m : columns) {
+            c.col.push_back(m);
+            c.val.push_back(row[m]);
+            position[m] = -1;
+        }
+        c.row_ptr.push_back(c.col.size());
+    }
+    return c;
+}
+
+} // namespace LinearAlgebra
@@ -0,0 +1,240 @@
+#include "Monitor.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+
+void Monitor::add_probe(double x, double y) { _probes.push_back({x, y}); }
+
+void Monitor::add_line(double x0, double y0, double x1, double y1, int n) {
+    _lines.push_back({x0, y0, x1, y1, std::max(n, 2)});
+}
+
+void Monitor::enable_heat_flux(double wall_temperature, double delta_temperature) {
+    _heat_flux = true;
+    _wall_temperature = wall_temperature;
+    _delta_temperature = delta_temperature;
+}
+
+void Monitor::enable_kinetic_energy() { _kinetic_energy = true; }
+
+void Monitor::enable_mass_flux() { _mass_flux = true; }
+
+void Monitor::set_frequency(int frequency) { _frequency = std::max(frequency, 1); }
+
+void Monitor::set_format(const std::string &format) { _binary = (format == "binary"); }
+
+bool Monitor::active() const {
+    return !_probes.empty() || !_lines.empty() || _heat_flux || _kinetic_energy || _mass_flux;
+}
+
+bool Monitor::due(int step) const { return active() && step % _frequency == 0; }
+
+void Monitor::open(const std::string &prefix, bool energy_eq) {
+    _energy_eq = energy_eq;
+    // Heat flux needs a temperature field
+    _heat_flux = _heat_flux && energy_eq;
+
+    std::vector<std::string> variables{"u", "v", "p"};
+    if (_energy_eq) {
+        variables.push_back("T");
+    }
+
+    std::vector<std::string> columns{"t"};
+    if (_heat_flux) {
+        columns.push_back("heat_flux");
+        columns.push_back("nusselt");
+    }
+    if (_kinetic_energy) {
+        columns.push_back("kinetic_energy");
+    }
+    if (_mass_flux) {
+        columns.push_back("mass_flux_in");
+        columns.push_back("mass_flux_out");
+    }
+    for (std::size_t k = 0; k < _probes.size(); ++k) {
+        for (auto &var : variables) {
+            columns.push_back("probe" + std::to_string(k) + "_" + var);
+        }
+    }
+    if (columns.size() > 1) {
+        _scalar_file = open_series(prefix + "_monitors", columns);
+    }
+
+    for (std::size_t k = 0; k < _lines.size(); ++k) {
+        std::vector<std::string> line_columns{"t"};
+        for (auto &var : variables) {
+            for (int n = 0; n < _lines[k].n; ++n) {
+                line_columns.push_back(var + "_" + std::to_string(n));
+            }
+        }
+        _line_files.push_back(open_series(prefix + "_line" + std::to_string(k), line_columns));
+    }
+}
+
+std::unique_ptr<std::ofstream> Monitor::open_series(const std::string &name, const std::vector<std::string> &columns) {
+    std::unique_ptr<std::ofstream> file;
+
+    if (_binary) {
+        // Column names go to a sidecar file, the series holds plain doubles
+        std::ofstream header(name + ".cols");
+        for (auto &col : columns) {
+            header << col << "\n";
+        }
+        file = std::make_unique<std::ofstream>(name + ".bin", std::ios::binary);
+    } else {
+        file = std::make_unique<std::ofstream>(name + ".csv");
+        for (std::size_t k = 0; k < columns.size(); ++k) {
+            *file << (k ? "," : "") << columns[k];
+        }
+        *file << "\n" << std::setprecision(std::numeric_limits<double>::digits10);
+    }
+
+    if (!file->good()) {
+        std::cerr << "Monitor file " << name << " could not be opened." << std::endl;
+    }
+    return file;
+}
+
+void Monitor::write_record(std::ofstream &file, const std::vector<double> &record) const {
+    if (_binary) {
+        file.write(reinterpret_cast<const char *>(record.data()), record.size() * sizeof(double));
+    } else {
+        for (std::size_t k = 0; k < record.size(); ++k) {
+            if (k) file << ',';
+            file << record[k];
+        }
+        file << '\n';
+    }
+}
+
+void Monitor::evaluate(const Fields &field, Grid &grid, double t) {
+    if (_scalar_file) {
+        _record.clear();
+        _record.push_back(t);
+        if (_heat_flux) {
+            double q = wall_heat_flux(field, grid);
+            _record.push_back(q);
+            _record.push_back(q / (field.alpha() * _delta_temperature));
+        }
+        if (_kinetic_energy) {
+            _record.push_back(kinetic_energy(field, grid));
+        }
+        if (_mass_flux) {
+            _record.push_back(inflow_mass_flux(field, grid));
+            _record.push_back(outflow_mass_flux(field, grid));
+        }
+        for (auto &probe : _probes) {
+            sample(field, grid, probe.x, probe.y, _record);
+        }
+        write_record(*_scalar_file, _record);
+    }
+
+    for (std::size_t k = 0; k < _lines.size(); ++k) {
+        const LineSample &line = _lines[k];
+
+        // Samples are stored point-major and written variable-major
+        std::vector<double> samples;
+        for (int n = 0; n < line.n; ++n) {
+            double s = static_cast<double>(n) / (line.n - 1);
+            sample(field, grid, line.x0 + s * (line.x1 - line.x0), line.y0 + s * (line.y1 - line.y0), samples);
+        }
+
+        int num_vars = samples.size() / line.n;
+        _record.clear();
+        _record.push_back(t);
+        for (int var = 0; var < num_vars; ++var) {
+            for (int n = 0; n < line.n; ++n) {
+                _record.push_back(samples[n * num_vars + var]);
+            }
+        }
+        write_record(*_line_files[k], _record);
+    }
+}
+
+void Monitor::close() {
+    if (_scalar_file) {
+        _scalar_file->close();
+    }
+    for (auto &file : _line_files) {
+        file->close();
+    }
+}
+
+void Monitor::sample(const Fields &field, Grid &grid, double x, double y, std::vector<double> &record) const {
+    int i = std::clamp(static_cast<int>(std::floor(x / grid.dx())) + 1, 1, grid.imax());
+    int j = std::clamp(static_cast<int>(std::floor(y / grid.dy())) + 1, 1, grid.jmax());
+    if (grid.stretched()) {
+        // Cell whose faces enclose the probe
+        i = 1;
+        while (i < grid.imax() && grid.x_face(i) <= x) ++i;
+        j = 1;
+        while (j < grid.jmax() && grid.y_face(j) <= y) ++j;
+    }
+
+    // Probes located in obstacles report NaN
+    if (grid.cell(i, j).type() != cell_type::FLUID) {
+        int num_vars = _energy_eq ? 4 : 3;
+        record.insert(record.end(), num_vars, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    record.push_back(0.5 * (field.u(i, j) + field.u(i - 1, j)));
+    record.push_back(0.5 * (field.v(i, j) + field.v(i, j - 1)));
+    record.push_back(field.p(i, j));
+    if (_energy_eq) {
+        record.push_back(field.t(i, j));
+    }
+}
+
+double Monitor::wall_heat_flux(const Fields &field, Grid &grid) const {
+    double q = 0.0;
+
+    // Wall temperature is located at the face, half a cell away from the fluid cell centre
+    for (auto &elem : grid.hot_fixed_wall_cells()) {
+        for (auto &border : elem->borders()) {
+            const Cell *nb = elem->neighbour(border);
+            double dx = grid.dx(nb->i());
+            double dy = grid.dy(nb->j());
+            double dT = _wall_temperature - field.t(nb->i(), nb->j());
+            if (border == border_position::LEFT || border == border_position::RIGHT) {
+                q += 2.0 * dT / dx * dy;
+            } else {
+                q += 2.0 * dT / dy * dx;
+            }
+        }
+    }
+    return field.alpha() * q;
+}
+
+double Monitor::kinetic_energy(const Fields &field, Grid &grid) const {
+    double energy = 0.0;
+    for (auto &elem : grid.fluid_cells()) {
+        int i = elem->i();
+        int j = elem->j();
+        double u = 0.5 * (field.u(i, j) + field.u(i - 1, j));
+        double v = 0.5 * (field.v(i, j) + field.v(i, j - 1));
+        double area = grid.stretched() ? grid.dx(i) * grid.dy(j) : 1.0;
+        energy += (u * u + v * v) * area;
+    }
+    return 0.5 * energy * (grid.stretched() ? 1.0 : grid.dx() * grid.dy());
+}
+
+double Monitor::inflow_mass_flux(const Fields &field, Grid &grid) const {
+    double flux = 0.0;
+    for (auto &elem : grid.inflow_cells()) {
+        flux += field.u(elem->i(), elem->j()) * (grid.stretched() ? grid.dy(elem->j()) : 1.0);
+    }
+    return flux * (grid.stretched() ? 1.0 : grid.dy());
+}
+
+double Monitor::outflow_mass_flux(const Fields &field, Grid &grid) const {
+    double flux = 0.0;
+    for (auto &elem : grid.outflow_cells()) {
+        flux += field.u(elem->neighbour(border_position::LEFT)->i(), elem->j()) *
+                (grid.stretched() ? grid.dy(elem->j()) : 1.0);
+    }
+    return flux * (grid.stretched() ? 1.0 : grid.dy());
+}
@@ -0,0 +1,243 @@
+#include "Multigrid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+using LinearAlgebra::CsrMatrix;
+
+AlgebraicMultigrid::AlgebraicMultigrid(CsrMatrix matrix) {
+    _levels.emplace_back();
+    _levels.back().A = std::move(matrix);
+
+    while (_levels.back().A.rows > max_coarse_size) {
+        Level &fine = _levels.back();
+        const CsrMatrix &A = fine.A;
+        const int n = A.rows;
+
+        std::vector<int> aggregates;
+        int num_aggregates = aggregate(A, aggregates);
+        if (num_aggregates >= n) break;
+
+        // Tentative prolongation, piecewise constant on the aggregates
+        CsrMatrix T;
+        T.rows = n;
+        T.cols = num_aggregates;
+        for (int i = 0; i < n; ++i) {
+            T.col.push_back(aggregates[i]);
+            T.val.push_back(1.0);
+            T.row_ptr.push_back(i + 1);
+        }
+
+        // Jacobi smoother of the prolongation, rho(D^-1 A) bounded by Gershgorin
+        double rho = 0.0;
+        std::vector<double> diag(n, 0.0);
+        for (int i = 0; i < n; ++i) {
+            double sum = 0.0;
+            for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+                if (A.col[k] == i) diag[i] = A.val[k];
+                sum += std::abs(A.val[k]);
+            }
+            rho = std::max(rho, sum / diag[i]);
+        }
+        double omega = 4.0 / (3.0 * rho);
+        CsrMatrix S = A;
+        for (int i = 0; i < n; ++i) {
+            for (int k = S.row_ptr[i]; k < S.row_ptr[i + 1]; ++k) {
+                S.val[k] = (S.col[k] == i ? 1.0 : 0.0) - omega * A.val[k] / diag[i];
+            }
+        }
+
+        fine.P = CsrMatrix::product(S, T);
+        fine.R = fine.P.transpose();
+        CsrMatrix coarse = CsrMatrix::product(fine.R, CsrMatrix::product(A, fine.P));
+        _levels.emplace_back();
+        _levels.back().A = std::move(coarse);
+    }
+
+    for (auto &level : _levels) {
+        const CsrMatrix &A = level.A;
+        level.inv_diag.assign(A.rows, 0.0);
+        for (int i = 0; i < A.rows; ++i) {
+            for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+                if (A.col[k] == i && A.val[k] != 0.0) level.inv_diag[i] = 1.0 / A.val[k];
+            }
+        }
+        level.x.assign(A.rows, 0.0);
+        level.b.assign(A.rows, 0.0);
+        level.r.assign(A.rows, 0.0);
+    }
+    factorize_coarse();
+}
+
+int AlgebraicMultigrid::aggregate(const CsrMatrix &A, std::vector<int> &aggregates) {
+    const int n = A.rows;
+    std::vector<double> diag(n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            if (A.col[k] == i) diag[i] = A.val[k];
+        }
+    }
+    auto strong = [&](int i, int k) {
+        int j = A.col[k];
+        return j != i && std::abs(A.val[k]) >= strength_threshold * std::sqrt(std::abs(diag[i] * diag[j]));
+    };
+
+    aggregates.assign(n, -1);
+    int num_aggregates = 0;
+
+    // Pass 1: unknowns whose strong neighbours are all free start an aggregate with them
+    for (int i = 0; i < n; ++i) {
+        if (aggregates[i] >= 0) continue;
+        bool free = true;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1] && free; ++k) {
+            if (strong(i, k) && aggregates[A.col[k]] >= 0) free = false;
+        }
+        if (!free) continue;
+        aggregates[i] = num_aggregates;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            if (strong(i, k)) aggregates[A.col[k]] = num_aggregates;
+        }
+        ++num_aggregates;
+    }
+
+    // Pass 2: remaining unknowns join the aggregate of their strongest aggregated neighbour
+    std::vector<int> joined = aggregates;
+    for (int i = 0; i < n; ++i) {
+        if (aggregates[i] >= 0) continue;
+        double strongest = 0.0;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            if (strong(i, k) && aggregates[A.col[k]] >= 0 && std::abs(A.val[k]) > strongest) {
+                strongest = std::abs(A.val[k]);
+                joined[i] = aggregates[A.col[k]];
+            }
+        }
+    }
+    aggregates = joined;
+
+    // Pass 3: unknowns without aggregated neighbours form their own aggregates
+    for (int i = 0; i < n; ++i) {
+        if (aggregates[i] < 0) aggregates[i] = num_aggregates++;
+    }
+    return num_aggregates;
+}
+
+void AlgebraicMultigrid::apply(const double *b, double *x) const { cycle(0, b, x); }
+
+void AlgebraicMultigrid::cycle(int level, const double *b, double *x) const {
+    const Level &l = _levels[level];
+    const CsrMatrix &A = l.A;
+    const int n = A.rows;
+
+    if (level + 1 == static_cast<int>(_levels.size())) {
+        solve_coarse(b, x);
+        return;
+    }
+
+    // Forward Gauss-Seidel from zero
+    std::fill(x, x + n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        double sum = b[i];
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            if (A.col[k] != i) sum -= A.val[k] * x[A.col[k]];
+        }
+        x[i] = sum * l.inv_diag[i];
+    }
+
+    // Coarse grid correction
+    A.multiply(x, l.r.data());
+    for (int i = 0; i < n; ++i) {
+        l.r[i] = b[i] - l.r[i];
+    }
+    const Level &coarse = _levels[level + 1];
+    l.R.multiply(l.r.data(), coarse.b.data());
+    cycle(level + 1, coarse.b.data(), coarse.x.data());
+    for (int i = 0; i < n; ++i) {
+        for (int k = l.P.row_ptr[i]; k < l.P.row_ptr[i + 1]; ++k) {
+            x[i] += l.P.val[k] * coarse.x[l.P.col[k]];
+        }
+    }
+
+    // Backward Gauss-Seidel
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = b[i];
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            if (A.col[k] != i) sum -= A.val[k] * x[A.col[k]];
+        }
+        x[i] = sum * l.inv_diag[i];
+    }
+}
+
+void AlgebraicMultigrid::factorize_coarse() {
+    const CsrMatrix &A = _levels.back().A;
+    const int n = A.rows;
+    _cholesky.assign(static_cast<size_t>(n) * n, 0.0);
+    for (int i = 0; i < n; ++i) {
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; ++k) {
+            _cholesky[static_cast<size_t>(i) * n + A.col[k]] = A.val[k];
+        }
+    }
+
+    _null_pivot.assign(n, false);
+    for (int j = 0; j < n; ++j) {
+        double *row_j = &_cholesky[static_cast<size_t>(j) * n];
+        double d = row_j[j];
+        for (int k = 0; k < j; ++k) {
+            d -= row_j[k] * row_j[k];
+        }
+        // row_j[j] still holds the diagonal entry of the matrix
+        if (!(d > null_pivot_tolerance * row_j[j])) {
+            // Dependent on the previous unknowns, e.g. the constant of a pure Neumann region
+            _null_pivot[j] = true;
+            row_j[j] = 1.0;
+            for (int i = j + 1; i < n; ++i) {
+                _cholesky[static_cast<size_t>(i) * n + j] = 0.0;
+            }
+            continue;
+        }
+        row_j[j] = std::sqrt(d);
+        for (int i = j + 1; i < n; ++i) {
+            double *row_i = &_cholesky[static_cast<size_t>(i) * n];
+            double sum = row_i[j];
+            for (int k = 0; k < j; ++k) {
+                sum -= row_i[k] * row_j[k];
+            }
+            row_i[j] = sum / row_j[j];
+        }
+    }
+}
+
+void AlgebraicMultigrid::solve_coarse(const double *b, double *x) const {
+    const int n = _levels.back().A.rows;
+    for (int i = 0; i < n; ++i) {
+        if (_null_pivot[i]) {
+            x[i] = 0.0;
+            continue;
+        }
+        const double *row = &_cholesky[static_cast<size_t>(i) * n];
+        double sum = b[i];
+        for (int k = 0; k < i; ++k) {
+            sum -= row[k] * x[k];
+        }
+        x[i] = sum / row[i];
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        double sum = x[i];
+        for (int k = i + 1; k < n; ++k) {
+            sum -= _cholesky[static_cast<size_t>(k) * n + i] * x[k];
+        }
+        x[i] = sum / _cholesky[static_cast<size_t>(i) * n + i];
+    }
+}
+
+void AlgebraicMultigrid::report(std::ostream &out) const {
+    long fine_nonzeros = _levels.front().A.nonzeros();
+    long nonzeros = 0;
+    out << "Algebraic multigrid levels (unknowns / nonzeros):";
+    for (const auto &level : _levels) {
+        out << " " << level.A.rows << " / " << level.A.nonzeros();
+        nonzeros += level.A.nonzeros();
+    }
+    out << "\nOperator complexity: " << std::setprecision(3)
+        << (fine_nonzeros ? static_cast<double>(nonzeros) / fine_nonzeros : 0.0) << std::setprecision(6) << "\n";
+}
@@ -0,0 +1,254 @@
+#include "Output.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+#include <vtkCellData.h>
+#include <vtkDoubleArray.h>
+#include <vtkPointData.h>
+#include <vtkPoints.h>
+#include <vtkRectilinearGrid.h>
+#include <vtkRectilinearGridWriter.h>
+#include <vtkSmartPointer.h>
+#include <vtkStructuredGrid.h>
+#include <vtkStructuredGridWriter.h>
+
+void OutputSettings::select_fields(const std::string &fields) {
+    pressure = false;
+    velocity = false;
+    temperature = false;
+
+    std::stringstream ss(fields);
+    std::string name;
+    while (std::getline(ss, name, ',')) {
+        if (name == "pressure") pressure = true;
+        if (name == "velocity") velocity = true;
+        if (name == "temperature") temperature = true;
+    }
+}
+
+bool OutputSettings::full() const {
+    return pressure && velocity && temperature && imin <= 1 && jmin <= 1 && imax <= 0 && jmax <= 0 && stride == 1;
+}
+
+std::vector<int> VTKOutput::corner_indices(int min, int max, int stride) {
+    // Corner c lies on the right/top face of cell c, so a block of cells
+    // [first, last] is bounded by the corners first - 1 and last.
+    std::vector<int> corners;
+    for (int c = min - 1; c < max; c += stride) {
+        corners.push_back(c);
+    }
+    corners.push_back(max);
+    return corners;
+}
+
+Snapshot VTKOutput::create_snapshot(Grid &grid, const std::vector<int> &corners_x, const std::vector<int> &corners_y) {
+    Snapshot snapshot;
+
+    double dx = grid.dx();
+    double dy = grid.dy();
+
+    for (int ci : corners_x) {
+        snapshot.x.push_back(grid.stretched() ? grid.x_face(ci) : (grid.domain().imin + ci + 1) * dx);
+    }
+    for (int cj : corners_y) {
+        snapshot.y.push_back(grid.stretched() ? grid.y_face(cj) : (grid.domain().jmin + cj + 1) * dy);
+    }
+    snapshot.rectilinear = grid.stretched();
+
+    // Blank the written cells whose lower left cell is an obstacle
+    int num_cells_x = corners_x.size() - 1;
+    int num_cells_y = corners_y.size() - 1;
+    for (int kj = 0; kj < num_cells_y; kj++) {
+        for (int ki = 0; ki < num_cells_x; ki++) {
+            if (grid.cell(corners_x[ki] + 1, corners_y[kj] + 1).wall_id() != 0) {
+                snapshot.blanked.push_back(ki + kj * num_cells_x);
+            }
+        }
+    }
+
+    return snapshot;
+}
+
+void VTKOutput::write(const std::string &file_name, Grid &grid, const Fields &field, const OutputSettings &settings,
+                      bool energy_eq) {
+    write(file_name, snapshot(grid, field, settings, energy_eq));
+}
+
+Snapshot VTKOutput::snapshot(Grid &grid, const Fields &field, const OutputSettings &settings, bool energy_eq) {
+    int imax = settings.imax > 0 ? std::min(settings.imax, grid.imax()) : grid.imax();
+    int jmax = settings.jmax > 0 ? std::min(settings.jmax, grid.jmax()) : grid.jmax();
+    int imin = std::clamp(settings.imin, 1, imax);
+    int jmin = std::clamp(settings.jmin, 1, jmax);
+    int stride = std::max(settings.stride, 1);
+
+    std::vector<int> corners_x = corner_indices(imin, imax, stride);
+    std::vector<int> corners_y = corner_indices(jmin, jmax, stride);
+
+    Snapshot snapshot = create_snapshot(grid, corners_x, corners_y);
+
+    if (settings.pressure) {
+        SnapshotArray pressure{"pressure", 1, false, {}};
+
+        // Print pressure from bottom to top
+        for (std::size_t kj = 0; kj + 1 < corners_y.size(); kj++) {
+            for (std::size_t ki = 0; ki + 1 < corners_x.size(); ki++) {
+                pressure.values.push_back(field.p(corners_x[ki] + 1, corners_y[kj] + 1));
+            }
+        }
+        snapshot.arrays.push_back(std::move(pressure));
+    }
+
+    if (settings.velocity) {
+        SnapshotArray velocity{"velocity", 3, true, {}};
+
+        // Print Velocity from bottom to top, velocity is written in single precision
+        for (int j : corners_y) {
+            for (int i : corners_x) {
+                velocity.values.push_back(static_cast<float>((field.u(i, j) + field.u(i, j + 1)) * 0.5));
+                velocity.values.push_back(static_cast<float>((field.v(i, j) + field.v(i + 1, j)) * 0.5));
+                velocity.values.push_back(0.0);
+            }
+        }
+        snapshot.arrays.push_back(std::move(velocity));
+    }
+
+    if (settings.temperature && energy_eq) {
+        SnapshotArray temperature{"temperature", 1, false, {}};
+
+        // Print Temperature from bottom to top
+        for (std::size_t kj = 0; kj + 1 < corners_y.size(); kj++) {
+            for (std::size_t ki = 0; ki + 1 < corners_x.size(); ki++) {
+                temperature.values.push_back(field.t(corners_x[ki] + 1, corners_y[kj] + 1));
+            }
+        }
+        snapshot.arrays.push_back(std::move(temperature));
+    }
+
+    return snapshot;
+}
+
+/// Adds the cell and point arrays of a snapshot to a VTK data set
+template <typename DataSet> static void add_arrays(const Snapshot &snapshot, DataSet *data_set) {
+    for (auto &array : snapshot.arrays) {
+        vtkSmartPointer<vtkDoubleArray> Array = vtkSmartPointer<vtkDoubleArray>::New();
+        Array->SetName(array.name.c_str());
+        Array->SetNumberOfComponents(array.num_components);
+        for (std::size_t k = 0; k < array.values.size(); k += array.num_components) {
+            Array->InsertNextTuple(&array.values[k]);
+        }
+
+        if (array.point_data) {
+            data_set->GetPointData()->AddArray(Array);
+        } else {
+            data_set->GetCellData()->AddArray(Array);
+        }
+    }
+}
+
+void VTKOutput::write(const std::string &file_name, const Snapshot &snapshot) {
+    if (snapshot.rectilinear) {
+        vtkSmartPointer<vtkRectilinearGrid> rectilinearGrid = vtkSmartPointer<vtkRectilinearGrid>::New();
+        auto coordinates = [](const std::vector<double> &values) {
+            vtkSmartPointer<vtkDoubleArray> array = vtkSmartPointer<vtkDoubleArray>::New();
+            for (double value : values) {
+                array->InsertNextValue(value);
+            }
+            return array;
+        };
+        rectilinearGrid->SetDimensions(snapshot.x.size(), snapshot.y.size(), 1);
+        rectilinearGrid->SetXCoordinates(coordinates(snapshot.x));
+        rectilinearGrid->SetYCoordinates(coordinates(snapshot.y));
+        rectilinearGrid->SetZCoordinates(coordinates({0.0}));
+
+        for (int id : snapshot.blanked) {
+            rectilinearGrid->BlankCell(id);
+        }
+        add_arrays(snapshot, rectilinearGrid.Get());
+
+        vtkSmartPointer<vtkRectilinearGridWriter> writer = vtkSmartPointer<vtkRectilinearGridWriter>::New();
+        writer->SetFileName(file_name.c_str());
+        writer->SetInputData(rectilinearGrid);
+        writer->Write();
+        return;
+    }
+
+    // Create a new structured grid
+    vtkSmartPointer<vtkStructuredGrid> structuredGrid = vtkSmartPointer<vtkStructuredGrid>::New();
+
+    // Create grid
+    vtkSmartPointer<vtkPoints> points = vtkSmartPointer<vtkPoints>::New();
+    double z = 0;
+    for (double y : snapshot.y) {
+        for (double x : snapshot.x) {
+            points->InsertNextPoint(x, y, z);
+        }
+    }
+
+    // Specify the dimensions of the grid
+    structuredGrid->SetDimensions(snapshot.x.size(), snapshot.y.size(), 1);
+    structuredGrid->SetPoints(points);
+
+    for (int id : snapshot.blanked) {
+        structuredGrid->BlankCell(id);
+    }
+
+    add_arrays(snapshot, structuredGrid.Get());
+
+    // Write Grid
+    vtkSmartPointer<vtkStructuredGridWriter> writer = vtkSmartPointer<vtkStructuredGridWriter>::New();
+    writer->SetFileName(file_name.c_str());
+    writer->SetInputData(structuredGrid);
+    writer->Write();
+}
+
+void VTKOutput::write_statistics(const std::string &file_name, Grid &grid, const Fields &field, bool energy_eq) {
+    std::vector<int> corners_x = corner_indices(1, grid.imax(), 1);
+    std::vector<int> corners_y = corner_indices(1, grid.jmax(), 1);
+
+    Snapshot snapshot = create_snapshot(grid, corners_x, corners_y);
+
+    std::vector<std::pair<field_type, std::string>> cell_fields{{field_type::P, "pressure"}};
+    if (energy_eq) {
+        cell_fields.push_back({field_type::T, "temperature"});
+    }
+
+    // Mean and RMS of the cell centered fields
+    for (auto &elem : cell_fields) {
+        SnapshotArray mean{elem.second + "_mean", 1, false, {}};
+        SnapshotArray rms{elem.second + "_rms", 1, false, {}};
+
+        for (int j = 1; j < grid.jmax() + 1; j++) {
+            for (int i = 1; i < grid.imax() + 1; i++) {
+                mean.values.push_back(field.mean(elem.first, i, j));
+                rms.values.push_back(field.rms(elem.first, i, j));
+            }
+        }
+
+        snapshot.arrays.push_back(std::move(mean));
+        snapshot.arrays.push_back(std::move(rms));
+    }
+
+    // Mean and RMS of the velocity, interpolated to the cell corners
+    SnapshotArray velocity_mean{"velocity_mean", 3, true, {}};
+    SnapshotArray velocity_rms{"velocity_rms", 3, true, {}};
+
+    for (int j : corners_y) {
+        for (int i : corners_x) {
+            velocity_mean.values.push_back((field.mean(field_type::U, i, j) + field.mean(field_type::U, i, j + 1)) *
+                                           0.5);
+            velocity_mean.values.push_back((field.mean(field_type::V, i, j) + field.mean(field_type::V, i + 1, j)) *
+                                           0.5);
+            velocity_mean.values.push_back(0.0);
+            velocity_rms.values.push_back((field.rms(field_type::U, i, j) + field.rms(field_type::U, i, j + 1)) * 0.5);
+            velocity_rms.values.push_back((field.rms(field_type::V, i, j) + field.rms(field_type::V, i + 1, j)) * 0.5);
+            velocity_rms.values.push_back(0.0);
+        }
+    }
+
+    snapshot.arrays.push_back(std::move(velocity_mean));
+    snapshot.arrays.push_back(std::move(velocity_rms));
+
+    write(file_name, snapshot);
+}
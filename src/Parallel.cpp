@@ -0,0 +1,97 @@
+#include "Parallel.hpp"
+#include "Trace.hpp"
+
+#include <algorithm>
+#include <memory>
+
+ThreadPool::ThreadPool(int num_threads) {
+    for (int id = 1; id < num_threads; ++id) {
+        _workers.emplace_back(&ThreadPool::work, this, id);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _start.notify_all();
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+}
+
+int ThreadPool::size() const { return _workers.size() + 1; }
+
+void ThreadPool::run(const std::function<void(int)> &task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _task = &task;
+        _pending = _workers.size();
+        ++_generation;
+    }
+    _start.notify_all();
+
+    task(0);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    _done.wait(lock, [this] { return _pending == 0; });
+    _task = nullptr;
+}
+
+void ThreadPool::work(int id) {
+    uint64_t generation = 0;
+    while (true) {
+        const std::function<void(int)> *task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _start.wait(lock, [&] { return _stop || _generation != generation; });
+            if (_stop) return;
+            generation = _generation;
+            task = _task;
+        }
+
+        (*task)(id);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_pending;
+        }
+        _done.notify_one();
+    }
+}
+
+namespace Parallel {
+
+static std::unique_ptr<ThreadPool> pool;
+
+void set_num_threads(int num_threads) {
+    num_threads = std::max(num_threads, 1);
+    if (num_threads == Parallel::num_threads()) return;
+    pool.reset();
+    if (num_threads > 1) {
+        pool = std::make_unique<ThreadPool>(num_threads);
+    }
+}
+
+int num_threads() { return pool ? pool->size() : 1; }
+
+int num_chunks(int n, int min_chunk) {
+    return std::max(1, std::min(num_threads(), n / std::max(min_chunk, 1)));
+}
+
+void run_chunks(int n, int chunks, const std::function<void(int, int, int)> &body) {
+    if (chunks == 1) {
+        body(0, 0, n);
+        return;
+    }
+    pool->run([&](int id) {
+        if (id < chunks) {
+            int64_t begin = Trace::enabled() ? Trace::now() : 0;
+            body(id, static_cast<int64_t>(id) * n / chunks, static_cast<int64_t>(id + 1) * n / chunks);
+            if (Trace::enabled()) Trace::record("chunk", "worker", begin, Trace::now());
+        }
+    });
+}
+
+} // namespace Parallel
@@ -0,0 +1,149 @@
+#include "PerfCounters.hpp"
+#include "Parallel.hpp"
+
+#include <algorithm>
+#include <iomanip>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/// Bytes moved from memory per last level cache miss
+static const double cache_line_size = 64.0;
+
+#ifdef __linux__
+static int open_event(uint32_t type, uint64_t config) {
+    perf_event_attr attr{};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    // Calling thread on any CPU
+    return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cache_event(uint64_t cache, uint64_t op, uint64_t result) { return cache | (op << 8) | (result << 16); }
+#endif
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+    for (const auto &fds : _fd) {
+        for (int fd : fds) {
+            if (fd >= 0) close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::open(uint64_t vector_event) {
+#ifdef __linux__
+    // Every thread of the pool opens its own counters, perf_event_open counts the calling thread only
+    const int threads = Parallel::num_threads();
+    for (auto &fds : _fd) {
+        fds.assign(threads, -1);
+    }
+    Parallel::run_chunks(threads, threads, [&](int thread, int, int) {
+        auto fd = [&](perf_event event) -> int & { return _fd[static_cast<int>(event)][thread]; };
+        fd(perf_event::CYCLES) = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+        fd(perf_event::INSTRUCTIONS) = open_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+        fd(perf_event::L1D_MISSES) =
+            open_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ,
+                                                       PERF_COUNT_HW_CACHE_RESULT_MISS));
+        fd(perf_event::LLC_MISSES) =
+            open_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL, PERF_COUNT_HW_CACHE_OP_READ,
+                                                       PERF_COUNT_HW_CACHE_RESULT_MISS));
+        if (vector_event != 0) {
+            fd(perf_event::VECTOR) = open_event(PERF_TYPE_RAW, vector_event);
+        }
+    });
+
+    // An event missing on some threads would be undercounted, it is dropped on all of them
+    for (auto &fds : _fd) {
+        if (std::find(fds.begin(), fds.end(), -1) != fds.end()) {
+            for (int fd : fds) {
+                if (fd >= 0) close(fd);
+            }
+            fds.clear();
+        }
+        for (int fd : fds) {
+            ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+    return is_open();
+}
+
+bool PerfCounters::is_open() const {
+    for (const auto &fds : _fd) {
+        if (!fds.empty()) return true;
+    }
+    return false;
+}
+
+void PerfCounters::read(std::array<double, num_perf_events> &values) const {
+    values.fill(0.0);
+#ifdef __linux__
+    for (int k = 0; k < num_perf_events; ++k) {
+        for (int fd : _fd[k]) {
+            // value, time enabled, time running
+            uint64_t data[3];
+            if (::read(fd, data, sizeof(data)) != sizeof(data)) continue;
+            values[k] += data[2] > 0 ? static_cast<double>(data[0]) * data[1] / data[2] : 0.0;
+        }
+    }
+#endif
+}
+
+void PerfCounters::start(step_phase phase) { read(_start[static_cast<int>(phase)]); }
+
+void PerfCounters::stop(step_phase phase) {
+    std::array<double, num_perf_events> values;
+    read(values);
+    int p = static_cast<int>(phase);
+    for (int k = 0; k < num_perf_events; ++k) {
+        _total[p][k] += values[k] - _start[p][k];
+    }
+}
+
+void PerfCounters::report(std::ostream &out, const std::array<double, num_step_phases> &phase_time, long cells,
+                          int steps) const {
+    auto available = [this](perf_event event) { return !_fd[static_cast<int>(event)].empty(); };
+    auto count = [this](int phase, perf_event event) { return _total[phase][static_cast<int>(event)]; };
+    const double cell_steps = std::max(1.0, static_cast<double>(cells) * steps);
+
+    out << "\nHardware counters per phase";
+    if (!available(perf_event::LLC_MISSES)) out << " (LLC misses unavailable)";
+    if (!available(perf_event::VECTOR)) out << " (vector instructions not counted)";
+    out << "\n";
+    out << std::left << std::setw(13) << "phase" << std::right << std::setw(10) << "time[s]" << std::setw(14)
+        << "instructions" << std::setw(8) << "IPC" << std::setw(12) << "L1D/cell" << std::setw(12) << "LLC/cell"
+        << std::setw(12) << "bytes/cell" << std::setw(9) << "GB/s" << std::setw(10) << "vector" << "\n";
+
+    for (int p = 0; p < num_step_phases; ++p) {
+        double cycles = count(p, perf_event::CYCLES);
+        double instructions = count(p, perf_event::INSTRUCTIONS);
+        double llc = count(p, perf_event::LLC_MISSES);
+        double bytes = llc * cache_line_size;
+
+        out << std::left << std::setw(13) << step_phase_name(static_cast<step_phase>(p)) << std::right << std::fixed
+            << std::setprecision(3) << std::setw(10) << phase_time[p] << std::setw(14) << std::scientific
+            << std::setprecision(3) << instructions << std::fixed << std::setprecision(2) << std::setw(8)
+            << (cycles > 0 ? instructions / cycles : 0.0) << std::setw(12)
+            << count(p, perf_event::L1D_MISSES) / cell_steps << std::setw(12) << llc / cell_steps << std::setw(12)
+            << bytes / cell_steps << std::setw(9) << (phase_time[p] > 0 ? bytes / phase_time[p] * 1e-9 : 0.0);
+        if (available(perf_event::VECTOR) && instructions > 0) {
+            out << std::setw(9) << 100.0 * count(p, perf_event::VECTOR) / instructions << "%";
+        } else {
+            out << std::setw(10) << "-";
+        }
+        out << "\n";
+    }
+    out << std::defaultfloat;
+}
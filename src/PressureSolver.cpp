@@ -1,39 +1,758 @@
 #include "PressureSolver.hpp"
+#include "Parallel.hpp"
 
+#include <algorithm>
 #include <cmath>
 #include <iostream>
+#include <map>
+#include <thread>
+
+HomogeneousPressureBoundary::HomogeneousPressureBoundary(const Grid &grid) {
+    const int imaxb = grid.imaxb();
+    const int jmaxb = grid.jmaxb();
+    auto fluid = [&](int i, int j) {
+        return i >= 0 && i < imaxb && j >= 0 && j < jmaxb && grid.cell(i, j).type() == cell_type::FLUID;
+    };
+    for (int j = 0; j < jmaxb; ++j) {
+        for (int i = 0; i < imaxb; ++i) {
+            if (fluid(i, j)) continue;
+            // Fluid neighbours in the order top, bottom, left, right
+            std::vector<int> neighbours;
+            const int di[] = {0, 0, -1, 1};
+            const int dj[] = {1, -1, 0, 0};
+            for (int n = 0; n < 4; ++n) {
+                if (fluid(i + di[n], j + dj[n])) {
+                    neighbours.push_back(i + di[n] + imaxb * (j + dj[n]));
+                }
+            }
+            if (neighbours.empty()) continue;
+
+            int cell = i + imaxb * j;
+            if (grid.cell(i, j).type() == cell_type::OUTFLOW) {
+                _stencils.push_back({cell, neighbours[0], -1, -1.0f});
+                _dirichlet = true;
+            } else if (neighbours.size() == 1) {
+                _stencils.push_back({cell, neighbours[0], -1, 1.0f});
+            } else {
+                _stencils.push_back({cell, neighbours[0], neighbours[1], 0.5f});
+            }
+        }
+    }
+}
+
+double PressureSolver::residual(Fields &field, Grid &grid) {
+    const auto &cells = grid.fluid_cells();
+
+    double rloc = 0.0;
+    field.p_matrix().update_halos();
+    Discretization::run([&](auto stretched) {
+        rloc = grid.sum_fluid_cells([&](auto block, int begin, int end) {
+            auto &&P = access(field.p_matrix(), block);
+            auto &&RS = access(field.rs_matrix(), block);
+            double sum = 0.0;
+            for (int k = begin; k < end; ++k) {
+                int i = cells[k]->i();
+                int j = cells[k]->j();
+
+                double val = Discretization::laplacian<stretched>(P, i, j) - RS(i, j);
+                sum += (val * val);
+            }
+            return sum;
+        });
+    });
+
+    double res = rloc / (grid.fluid_cells().size());
+    return std::sqrt(res);
+}
 
 SOR::SOR(double omega) : _omega(omega) {}
 
 double SOR::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    sweep(field, grid);
+    return residual(field, grid);
+}
+
+void SOR::sweep(Fields &field, Grid &grid) {
 
     double dx = grid.dx();
     double dy = grid.dy();
 
     double coeff = _omega / (2.0 * (1.0 / (dx * dx) + 1.0 / (dy * dy))); // = _omega * h^2 / 4.0, if dx == dy == h
 
-    for (auto currentCell : grid.fluid_cells()) {
-        int i = currentCell->i();
-        int j = currentCell->j();
+    // Lexicographic Gauss-Seidel ordering, the sweep is sequential
+    const auto &cells = grid.fluid_cells();
+    field.p_matrix().update_halos();
+    Discretization::run([&](auto stretched) {
+        grid.sweep_fluid_cells([&](auto block, int begin, int end) {
+            auto &&P = access(field.p_matrix(), block);
+            auto &&RS = access(field.rs_matrix(), block);
+            for (int k = begin; k < end; ++k) {
+                int i = cells[k]->i();
+                int j = cells[k]->j();
+
+                if constexpr (stretched) {
+                    P(i, j) = (1.0 - _omega) * P(i, j) + _omega / Discretization::sor_diagonal<true>(i, j) *
+                                                             (Discretization::sor_helper<true>(P, i, j) - RS(i, j));
+                } else {
+                    P(i, j) =
+                        (1.0 - _omega) * P(i, j) + coeff * (Discretization::sor_helper<false>(P, i, j) - RS(i, j));
+                }
+            }
+            // The tiles relaxed later read the new values from their halos, as the sweep over dense storage
+            if constexpr (std::is_same<decltype(block), TileCells>::value) field.p_matrix().copy_halos(block.slot);
+        });
+    });
+}
+
+LineSOR::LineSOR(double omega) : _omega(omega) {}
+
+double LineSOR::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    sweep(field, grid);
+    return residual(field, grid);
+}
+
+void LineSOR::setup(const Grid &grid) {
+    _grid = &grid;
+    double dx = grid.dx();
+    double dy = grid.dy();
+    _x_lines = dx <= dy;
+    const int stride = grid.imaxb();
+
+    // Lines along x are rows j, lines along y are columns i
+    int num_lines = _x_lines ? grid.jmaxb() : grid.imaxb();
+    int line_size = _x_lines ? grid.imaxb() : grid.jmaxb();
+    auto fluid = [&](int line, int k) {
+        return (_x_lines ? grid.cell(k, line) : grid.cell(line, k)).type() == cell_type::FLUID;
+    };
+    auto index = [&](int line, int k) { return _x_lines ? k + stride * line : line + stride * k; };
 
-        field.p(i, j) = (1.0 - _omega) * field.p(i, j) +
-                        coeff * (Discretization::sor_helper(field.p_matrix(), i, j) - field.rs(i, j));
+    // Boundary stencil of every cell, -1 for cells without one
+    const HomogeneousPressureBoundary boundary(grid);
+    const auto &stencils = boundary.stencils();
+    std::vector<int> stencil_of(grid.imaxb() * grid.jmaxb(), -1);
+    for (std::size_t k = 0; k < stencils.size(); ++k) {
+        stencil_of[stencils[k].cell] = k;
     }
 
-    double res = 0.0;
-    double rloc = 0.0;
+    // Coupling along and across the lines
+    double along = _x_lines ? 1.0 / (dx * dx) : 1.0 / (dy * dy);
+    double across = _x_lines ? 1.0 / (dy * dy) : 1.0 / (dx * dx);
+    _systems = LinearAlgebra::TridiagonalSystems(-along, -along);
+    _ends.clear();
+
+    // Boundary cell next to the fluid cell at position k, its value depends on P(fluid) by the returned weight
+    auto add_end = [&](int line, int boundary, int k) {
+        const auto &b = stencils[stencil_of[index(line, boundary)]];
+        int cell = index(line, k);
+        int other = b.first == cell ? b.second : b.first;
+        double self = (b.first == cell || b.second == cell) ? b.weight : 0.0;
+        _ends.push_back({b.cell, cell, other, self, b.weight});
+        return self;
+    };
+
+    long num_cells = 0;
+    for (auto &segments : _segments) {
+        segments.clear();
+    }
+    std::vector<double> diag;
+    for (int line = 0; line < num_lines; ++line) {
+        int k = 0;
+        while (k < line_size) {
+            if (!fluid(line, k)) {
+                ++k;
+                continue;
+            }
+            int begin = k;
+            while (k < line_size && fluid(line, k)) {
+                ++k;
+            }
+
+            Segment segment{line, begin, k, 0, {static_cast<int>(_ends.size()), static_cast<int>(_ends.size()) + 1}};
+            diag.assign(k - begin, 2.0 * (along + across));
+            diag.front() -= along * add_end(line, begin - 1, begin);
+            diag.back() -= along * add_end(line, k, k - 1);
+            segment.system = _systems.add(diag);
+
+            _segments[line % 2].push_back(segment);
+            num_cells += k - begin;
+        }
+    }
+    _end_constants.assign(_ends.size(), 0.0);
+    _end_values.assign(_ends.size(), 0.0);
+
+    long num_segments = _segments[0].size() + _segments[1].size();
+    _min_chunk = std::max<long>(1, 256 * num_segments / std::max<long>(num_cells, 1));
+}
+
+void LineSOR::sweep(Fields &field, Grid &grid) {
+    if (_grid != &grid) setup(grid);
+
+    double dx = grid.dx();
+    double dy = grid.dy();
+    double along = _x_lines ? 1.0 / (dx * dx) : 1.0 / (dy * dy);
+    double across = _x_lines ? 1.0 / (dy * dy) : 1.0 / (dx * dx);
+    const bool x_lines = _x_lines;
+    double *data = field.p_matrix().data();
+
+    Matrix<double> &P = field.p_matrix();
+    const Matrix<double> &RS = field.rs_matrix();
+
+    // Pressure at position k of a line
+    auto p = [&P, x_lines](int line, int k) -> double & { return x_lines ? P(k, line) : P(line, k); };
+
+    // Boundary values set before the call, e.g. twice the outlet pressure
+    for (std::size_t e = 0; e < _ends.size(); ++e) {
+        const End &b = _ends[e];
+        _end_constants[e] =
+            data[b.cell] - b.self * data[b.fluid] - (b.other >= 0 ? b.weight * data[b.other] : 0.0);
+    }
 
-    for (auto currentCell : grid.fluid_cells()) {
-        int i = currentCell->i();
-        int j = currentCell->j();
+    for (auto &segments : _segments) {
+        // Neighbours of the boundary cells outside the segment are taken from the current iterate
+        for (std::size_t e = 0; e < _ends.size(); ++e) {
+            const End &b = _ends[e];
+            _end_values[e] = _end_constants[e] + (b.other >= 0 ? b.weight * data[b.other] : 0.0);
+        }
+
+        Parallel::parallel_for(
+            segments.size(),
+            [&](int first, int last) {
+                std::vector<double> x(grid.imaxb() + grid.jmaxb());
+                for (int s = first; s < last; ++s) {
+                    const Segment &segment = segments[s];
+                    int line = segment.line;
+                    int n = segment.end - segment.begin;
+
+                    for (int m = 0; m < n; ++m) {
+                        int k = segment.begin + m;
+                        double rs = x_lines ? RS(k, line) : RS(line, k);
+                        x[m] = across * (p(line - 1, k) + p(line + 1, k)) - rs;
+                    }
+                    x[0] += along * _end_values[segment.ends[0]];
+                    x[n - 1] += along * _end_values[segment.ends[1]];
+
+                    _systems.solve(segment.system, n, x.data());
+
+                    for (int m = 0; m < n; ++m) {
+                        double &value = p(line, segment.begin + m);
+                        value = (1.0 - _omega) * value + _omega * x[m];
+                    }
+                }
+            },
+            _min_chunk);
+    }
+}
+
+MixedPrecisionSOR::MixedPrecisionSOR(double omega, int inner_sweeps)
+    : _omega(omega), _inner_sweeps(std::max(inner_sweeps, 1)) {}
+
+void MixedPrecisionSOR::setup(const Grid &grid) {
+    _grid = &grid;
+    _stride = grid.imaxb();
+    const int imaxb = grid.imaxb();
+    const int jmaxb = grid.jmaxb();
+
+    _fluid.clear();
+    for (auto cell : grid.fluid_cells()) {
+        _fluid.push_back(cell->i() + _stride * cell->j());
+    }
+
+    _boundary = HomogeneousPressureBoundary(grid);
+
+    _correction.assign(imaxb * jmaxb, 0.0f);
+    _residual.assign(imaxb * jmaxb, 0.0f);
+}
+
+double MixedPrecisionSOR::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    if (_grid != &grid) setup(grid);
+
+    const auto &cells = grid.fluid_cells();
+    const int stride = _stride;
+    Matrix<double> &P = field.p_matrix();
+    const Matrix<double> &RS = field.rs_matrix();
+
+    // Residual of the current pressure in double precision
+    Parallel::parallel_for(cells.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            int i = cells[k]->i();
+            int j = cells[k]->j();
+            _residual[i + stride * j] = static_cast<float>(RS(i, j) - Discretization::laplacian(P, i, j));
+        }
+    });
+
+    // Single-precision SOR on the correction equation, starting from zero
+    const float ax = 1.0 / (grid.dx() * grid.dx());
+    const float ay = 1.0 / (grid.dy() * grid.dy());
+    const float omega = _omega;
+    const float coeff = _omega / (2.0 * (1.0 / (grid.dx() * grid.dx()) + 1.0 / (grid.dy() * grid.dy())));
+    float *e = _correction.data();
+    const float *r = _residual.data();
+
+    std::fill(_correction.begin(), _correction.end(), 0.0f);
+    for (int sweep = 0; sweep < _inner_sweeps; ++sweep) {
+        _boundary.apply(e);
+        for (int idx : _fluid) {
+            e[idx] = (1.0f - omega) * e[idx] +
+                     coeff * ((e[idx + 1] + e[idx - 1]) * ax + (e[idx + stride] + e[idx - stride]) * ay - r[idx]);
+        }
+    }
+    _boundary.apply(e);
+
+    // The boundary values stay consistent with the pressure boundary conditions
+    Parallel::parallel_for(cells.size(), [&](int begin, int end) {
+        for (int k = begin; k < end; ++k) {
+            int i = cells[k]->i();
+            int j = cells[k]->j();
+            P(i, j) += e[i + stride * j];
+        }
+    });
+    _boundary.add_to_pressure(field, e, stride);
+
+    return residual(field, grid);
+}
+
+BlockedSOR::BlockedSOR(double omega, int sweeps) : _omega(omega), _sweeps(std::max(sweeps, 1)) {}
+
+void BlockedSOR::setup(const Grid &grid) {
+    _grid = &grid;
+    _stride = grid.imaxb();
+
+    _segments.clear();
+    _row_begin.assign(1, 0);
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        int i = 0;
+        while (i < grid.imaxb()) {
+            if (grid.cell(i, j).type() != cell_type::FLUID) {
+                ++i;
+                continue;
+            }
+            int begin = i;
+            while (i < grid.imaxb() && grid.cell(i, j).type() == cell_type::FLUID) {
+                ++i;
+            }
+            _segments.push_back({begin + _stride * j, i + _stride * j});
+        }
+        _row_begin.push_back(_segments.size());
+    }
+
+    // Stencils are ordered by row
+    _stencils = HomogeneousPressureBoundary(grid).stencils();
+    _offsets.assign(_stencils.size(), 0.0);
+    _stencil_begin.assign(grid.jmaxb() + 1, 0);
+    for (const auto &b : _stencils) {
+        ++_stencil_begin[b.cell / _stride + 1];
+    }
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        _stencil_begin[j + 1] += _stencil_begin[j];
+    }
+
+    // A tile and the rows trailing it for the later sweeps hold P and RS
+    long row_bytes = 2 * sizeof(double) * static_cast<long>(_stride);
+    _tile_rows = std::max<long>(1, tile_cache_bytes / row_bytes - 2 * _sweeps);
+}
+
+double BlockedSOR::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    sweep(field, grid);
+    return residual(field, grid);
+}
+
+void BlockedSOR::sweep(Fields &field, Grid &grid) {
+    if (_grid != &grid) setup(grid);
+
+    double dx = grid.dx();
+    double dy = grid.dy();
+    const double omega = _omega;
+    const double coeff = _omega / (2.0 * (1.0 / (dx * dx) + 1.0 / (dy * dy)));
+    const double dx2 = dx * dx;
+    const double dy2 = dy * dy;
+    const int stride = _stride;
+    double *p = field.p_matrix().data();
+    const double *rs = field.rs_matrix().data();
+
+    // Constant parts of the boundary values set before the call, e.g. twice the outlet pressure
+    auto value = [&](const HomogeneousPressureBoundary::Stencil &b) {
+        return b.weight * (p[b.first] + (b.second >= 0 ? p[b.second] : 0.0));
+    };
+    for (size_t k = 0; k < _stencils.size(); ++k) {
+        _offsets[k] = p[_stencils[k].cell] - value(_stencils[k]);
+    }
+    auto refresh_row = [&](int j) {
+        if (j >= static_cast<int>(_stencil_begin.size()) - 1) return;
+        for (int k = _stencil_begin[j]; k < _stencil_begin[j + 1]; ++k) {
+            p[_stencils[k].cell] = value(_stencils[k]) + _offsets[k];
+        }
+    };
+
+    // Same arithmetic as SOR::sweep and Discretization::sor_helper
+    auto relax_row = [&](int j) {
+        for (int k = _row_begin[j]; k < _row_begin[j + 1]; ++k) {
+            for (int idx = _segments[k].begin; idx < _segments[k].end; ++idx) {
+                double helper = (p[idx + 1] + p[idx - 1]) / dx2 + (p[idx + stride] + p[idx - stride]) / dy2;
+                p[idx] = (1.0 - omega) * p[idx] + coeff * (helper - rs[idx]);
+            }
+        }
+    };
+
+    // Rows relaxed so far by every sweep
+    const int num_rows = _row_begin.size() - 1;
+    std::vector<int> done(_sweeps, 0);
+    while (done[_sweeps - 1] < num_rows) {
+        for (int s = 0; s < _sweeps; ++s) {
+            int limit;
+            if (s == 0) {
+                limit = std::min(done[0] + _tile_rows, num_rows);
+            } else {
+                limit = done[s - 1] == num_rows ? num_rows : std::max(done[s - 1] - 2, done[s]);
+            }
+            for (int j = done[s]; j < limit; ++j) {
+                // Boundary values are refreshed before their first reader, the row below
+                if (j == 0) refresh_row(0);
+                refresh_row(j + 1);
+                relax_row(j);
+            }
+            done[s] = limit;
+        }
+    }
+}
+
+WavefrontSOR::WavefrontSOR(double omega) : _omega(omega) {}
+
+void WavefrontSOR::setup(const Grid &grid) {
+    _grid = &grid;
+    _num_threads = Parallel::num_threads();
+    _num_blocks = std::max(1, std::min(_num_threads, grid.imax() / min_block_columns));
+    _num_rows = grid.jmaxb();
+
+    // Block b covers the interior columns [1 + b * imax / blocks, 1 + (b + 1) * imax / blocks)
+    std::vector<int> block_of(grid.imaxb(), 0);
+    for (int i = 1; i < grid.imaxb(); ++i) {
+        block_of[i] = std::min(static_cast<int>(static_cast<long>(i - 1) * _num_blocks / grid.imax()), _num_blocks - 1);
+    }
+
+    _cells.clear();
+    _block_begin.assign(1, 0);
+    for (int j = 0; j < _num_rows; ++j) {
+        for (int b = 0; b < _num_blocks; ++b) {
+            for (int i = 0; i < grid.imaxb(); ++i) {
+                if (block_of[i] == b && grid.cell(i, j).type() == cell_type::FLUID) {
+                    _cells.push_back(i + grid.imaxb() * j);
+                }
+            }
+            _block_begin.push_back(_cells.size());
+        }
+    }
+    _progress = std::make_unique<Progress[]>(_num_blocks);
+}
+
+double WavefrontSOR::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    sweep(field, grid);
+    return residual(field, grid);
+}
+
+void WavefrontSOR::sweep(Fields &field, Grid &grid) {
+    if (_grid != &grid || _num_threads != Parallel::num_threads()) setup(grid);
+
+    double dx = grid.dx();
+    double dy = grid.dy();
+    const double omega = _omega;
+    const double coeff = _omega / (2.0 * (1.0 / (dx * dx) + 1.0 / (dy * dy)));
+    const double dx2 = dx * dx;
+    const double dy2 = dy * dy;
+    const int stride = grid.imaxb();
+    double *p = field.p_matrix().data();
+    const double *rs = field.rs_matrix().data();
+
+    // Same arithmetic as SOR::sweep and Discretization::sor_helper
+    auto relax_block = [&](int j, int b) {
+        const int block = j * _num_blocks + b;
+        for (int k = _block_begin[block]; k < _block_begin[block + 1]; ++k) {
+            int idx = _cells[k];
+            double helper = (p[idx + 1] + p[idx - 1]) / dx2 + (p[idx + stride] + p[idx - stride]) / dy2;
+            p[idx] = (1.0 - omega) * p[idx] + coeff * (helper - rs[idx]);
+        }
+    };
+
+    if (_num_blocks == 1) {
+        for (int j = 0; j < _num_rows; ++j) {
+            relax_block(j, 0);
+        }
+        return;
+    }
+
+    for (int b = 0; b < _num_blocks; ++b) {
+        _progress[b].rows.store(0, std::memory_order_relaxed);
+    }
+    Parallel::parallel_for(
+        _num_blocks,
+        [&](int begin, int end) {
+            for (int b = begin; b < end; ++b) {
+                for (int j = 0; j < _num_rows; ++j) {
+                    if (b > 0) {
+                        // The left neighbours of the block must hold their new values
+                        while (_progress[b - 1].rows.load(std::memory_order_acquire) <= j) {
+                            std::this_thread::yield();
+                        }
+                    }
+                    relax_block(j, b);
+                    _progress[b].rows.store(j + 1, std::memory_order_release);
+                }
+            }
+        },
+        1);
+}
+
+void ChebyshevJacobi::setup(const Grid &grid) {
+    _grid = &grid;
+    _stride = grid.imaxb();
+
+    _rows.clear();
+    long num_cells = 0;
+    for (int j = 0; j < grid.jmaxb(); ++j) {
+        int i = 0;
+        while (i < grid.imaxb()) {
+            if (grid.cell(i, j).type() != cell_type::FLUID) {
+                ++i;
+                continue;
+            }
+            int begin = i;
+            while (i < grid.imaxb() && grid.cell(i, j).type() == cell_type::FLUID) {
+                ++i;
+            }
+            _rows.push_back({begin + _stride * j, i + _stride * j});
+            num_cells += i - begin;
+        }
+    }
+    _min_chunk = std::max<long>(1, 256 * static_cast<long>(_rows.size()) / std::max<long>(num_cells, 1));
+
+    _boundary = HomogeneousPressureBoundary(grid);
+    _mu = estimate_radius(grid);
+}
+
+double ChebyshevJacobi::estimate_radius(const Grid &grid) const {
+    const int stride = _stride;
+    const double ax = 1.0 / (grid.dx() * grid.dx());
+    const double ay = 1.0 / (grid.dy() * grid.dy());
+    const double inv_diag = 1.0 / (2.0 * (ax + ay));
+
+    // Smooth start vector, without the constant null space of pure Neumann problems
+    std::vector<double> v(grid.imaxb() * grid.jmaxb(), 0.0);
+    std::vector<double> w(v.size(), 0.0);
+    auto project = [&](std::vector<double> &x) {
+        if (_boundary.dirichlet()) return;
+        double mean = 0.0;
+        for (auto cell : grid.fluid_cells()) {
+            mean += x[cell->i() + stride * cell->j()];
+        }
+        mean /= grid.fluid_cells().size();
+        for (auto cell : grid.fluid_cells()) {
+            x[cell->i() + stride * cell->j()] -= mean;
+        }
+    };
+    for (auto cell : grid.fluid_cells()) {
+        v[cell->i() + stride * cell->j()] =
+            static_cast<double>(cell->i()) / grid.imax() + static_cast<double>(cell->j()) / grid.jmax();
+    }
+    project(v);
+
+    double mu = 0.0;
+    for (int k = 0; k < power_iterations; ++k) {
+        _boundary.apply(v.data());
+        double vv = 0.0;
+        double vw = 0.0;
+        for (auto cell : grid.fluid_cells()) {
+            int idx = cell->i() + stride * cell->j();
+            w[idx] = (ax * (v[idx - 1] + v[idx + 1]) + ay * (v[idx - stride] + v[idx + stride])) * inv_diag;
+            vv += v[idx] * v[idx];
+            vw += v[idx] * w[idx];
+        }
+        if (vv == 0.0) break;
+        // Rayleigh quotient, the iteration matrix being symmetric for uniform cells
+        mu = std::abs(vw / vv);
+        project(w);
+        std::swap(v, w);
+    }
+    return std::min(mu, 1.0 - 1e-12);
+}
+
+void ChebyshevJacobi::initialize(Fields &field, Grid &grid) {
+    if (_grid != &grid) setup(grid);
+    _previous = field.p_matrix();
+    _iteration = 0;
+}
+
+double ChebyshevJacobi::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    if (_grid != &grid) initialize(field, grid);
+
+    if (_iteration == 0) {
+        _weight = 1.0;
+    } else if (_iteration == 1) {
+        _weight = 1.0 / (1.0 - 0.5 * _mu * _mu);
+    } else {
+        _weight = 1.0 / (1.0 - 0.25 * _mu * _mu * _weight);
+    }
+    ++_iteration;
+
+    const int stride = _stride;
+    const double ax = 1.0 / (grid.dx() * grid.dx());
+    const double ay = 1.0 / (grid.dy() * grid.dy());
+    const double inv_diag = 1.0 / (2.0 * (ax + ay));
+    const double weight = _weight;
+    const double *__restrict p = field.p_matrix().data();
+    const double *__restrict rs = field.rs_matrix().data();
+    double *__restrict next = _previous.data();
+
+    Parallel::parallel_for(
+        _rows.size(),
+        [&](int first, int last) {
+            for (int r = first; r < last; ++r) {
+                for (int idx = _rows[r].begin; idx < _rows[r].end; ++idx) {
+                    double jacobi =
+                        (ax * (p[idx - 1] + p[idx + 1]) + ay * (p[idx - stride] + p[idx + stride]) - rs[idx]) * inv_diag;
+                    next[idx] += weight * (jacobi - next[idx]);
+                }
+            }
+        },
+        _min_chunk);
+
+    std::swap(field.p_matrix(), _previous);
+    return residual(field, grid);
+}
+
+AMGSolver::AMGSolver(const Grid &grid, bool pcg) : _pcg(pcg), _stride(grid.imaxb()), _boundary(grid) {
+    const int stride = _stride;
+    std::vector<int> unknown(grid.imaxb() * grid.jmaxb(), -1);
+    for (auto cell : grid.fluid_cells()) {
+        unknown[cell->i() + stride * cell->j()] = _cells.size();
+        _cells.push_back(cell->i() + stride * cell->j());
+    }
+    std::vector<const HomogeneousPressureBoundary::Stencil *> stencil(unknown.size(), nullptr);
+    for (const auto &b : _boundary.stencils()) {
+        stencil[b.cell] = &b;
+    }
+
+    // Negated Laplacian, boundary values replaced by their stencils
+    const double ax = 1.0 / (grid.dx() * grid.dx());
+    const double ay = 1.0 / (grid.dy() * grid.dy());
+    const int n = _cells.size();
+    std::vector<std::map<int, double>> rows(n);
+    for (int row = 0; row < n; ++row) {
+        int idx = _cells[row];
+        const int neighbours[] = {idx - 1, idx + 1, idx - stride, idx + stride};
+        const double coefficients[] = {ax, ax, ay, ay};
+        for (int k = 0; k < 4; ++k) {
+            int cell = neighbours[k];
+            double a = coefficients[k];
+            rows[row][row] += a;
+            if (unknown[cell] >= 0) {
+                rows[row][unknown[cell]] -= a;
+            } else if (stencil[cell]) {
+                rows[row][unknown[stencil[cell]->first]] -= a * stencil[cell]->weight;
+                if (stencil[cell]->second >= 0) rows[row][unknown[stencil[cell]->second]] -= a * stencil[cell]->weight;
+            }
+        }
+    }
+
+    LinearAlgebra::CsrMatrix A;
+    A.rows = n;
+    A.cols = n;
+    for (int row = 0; row < n; ++row) {
+        for (auto &entry : rows[row]) {
+            double value = entry.second;
+            if (entry.first != row) {
+                auto transposed = rows[entry.first].find(row);
+                value = 0.5 * (value + (transposed != rows[entry.first].end() ? transposed->second : 0.0));
+            }
+            A.col.push_back(entry.first);
+            A.val.push_back(value);
+        }
+        A.row_ptr.push_back(A.col.size());
+    }
+    _multigrid = AlgebraicMultigrid(std::move(A));
+
+    _r.assign(n, 0.0);
+    _z.assign(n, 0.0);
+    _d.assign(n, 0.0);
+    _q.assign(n, 0.0);
+    _update.assign(unknown.size(), 0.0);
+}
+
+void AMGSolver::initialize(Fields &field, Grid &grid) { _started = false; }
+
+double AMGSolver::dot(const std::vector<double> &x, const std::vector<double> &y) {
+    double sum = 0.0;
+    for (size_t k = 0; k < x.size(); ++k) {
+        sum += x[k] * y[k];
+    }
+    return sum;
+}
+
+void AMGSolver::project(std::vector<double> &x) const {
+    if (_boundary.dirichlet() || x.empty()) return;
+    double mean = 0.0;
+    for (double value : x) {
+        mean += value;
+    }
+    mean /= x.size();
+    for (double &value : x) {
+        value -= mean;
+    }
+}
+
+void AMGSolver::defect(Fields &field, Grid &grid, std::vector<double> &b) const {
+    for (size_t k = 0; k < _cells.size(); ++k) {
+        int i = _cells[k] % _stride;
+        int j = _cells[k] / _stride;
+        b[k] = Discretization::laplacian(field.p_matrix(), i, j) - field.rs_matrix()(i, j);
+    }
+    project(b);
+}
+
+void AMGSolver::correct(Fields &field, const std::vector<double> &e, double scale) {
+    for (size_t k = 0; k < _cells.size(); ++k) {
+        _update[_cells[k]] = scale * e[k];
+    }
+    _boundary.apply(_update.data());
+    for (size_t k = 0; k < _cells.size(); ++k) {
+        field.p_matrix()(_cells[k] % _stride, _cells[k] / _stride) += _update[_cells[k]];
+    }
+    _boundary.add_to_pressure(field, _update.data(), _stride);
+}
+
+double AMGSolver::solve(Fields &field, Grid &grid, const std::vector<std::unique_ptr<Boundary>> &boundaries) {
+    const auto &A = _multigrid.matrix();
+
+    if (!_pcg) {
+        defect(field, grid, _r);
+        _multigrid.apply(_r.data(), _z.data());
+        correct(field, _z, 1.0);
+        return residual(field, grid);
+    }
+
+    if (!_started) {
+        defect(field, grid, _r);
+        _multigrid.apply(_r.data(), _z.data());
+        _d = _z;
+        _rz = dot(_r, _z);
+        _started = true;
+    }
 
-        double val = Discretization::laplacian(field.p_matrix(), i, j) - field.rs(i, j);
-        rloc += (val * val);
+    A.multiply(_d.data(), _q.data());
+    double dq = dot(_d, _q);
+    double alpha = dq != 0.0 ? _rz / dq : 0.0;
+    correct(field, _d, alpha);
+    for (size_t k = 0; k < _r.size(); ++k) {
+        _r[k] -= alpha * _q[k];
     }
-    {
-        res = rloc / (grid.fluid_cells().size());
-        res = std::sqrt(res);
+    _multigrid.apply(_r.data(), _z.data());
+    double rz = dot(_r, _z);
+    double beta = _rz != 0.0 ? rz / _rz : 0.0;
+    _rz = rz;
+    for (size_t k = 0; k < _d.size(); ++k) {
+        _d[k] = _z[k] + beta * _d[k];
     }
 
+    double res = residual(field, grid);
+    // Restart from the true residual once the assembled model no longer represents it
+    if (std::sqrt(dot(_r, _r) / _r.size()) < 0.5 * res) _started = false;
     return res;
 }
@@ -0,0 +1,213 @@
+#include "Scaling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#include "Boundary.hpp"
+#include "Discretization.hpp"
+#include "Domain.hpp"
+#include "Enums.hpp"
+#include "Fields.hpp"
+#include "Grid.hpp"
+#include "Output.hpp"
+#include "Parallel.hpp"
+#include "PressureSolver.hpp"
+
+bool ScalingSettings::parse(int argn, char **args) {
+    for (int k = 0; k < argn; ++k) {
+        std::string arg(args[k]);
+        bool has_value = k + 1 < argn;
+        if (arg == "cavity" || arg == "channel") {
+            problem = arg;
+        } else if (arg == "--size" && has_value) {
+            size = std::stoi(args[++k]);
+        } else if (arg == "--steps" && has_value) {
+            steps = std::stoi(args[++k]);
+        } else if (arg == "--sor-iterations" && has_value) {
+            sor_iterations = std::stoi(args[++k]);
+        } else if (arg == "--threads" && has_value) {
+            std::stringstream ss(args[++k]);
+            std::string count;
+            while (std::getline(ss, count, ',')) {
+                threads.push_back(std::stoi(count));
+            }
+        } else {
+            std::cout << "Unknown scaling option " << arg << std::endl;
+            return false;
+        }
+    }
+
+    size = std::max(size, 4);
+    steps = std::max(steps, 1);
+    sor_iterations = std::max(sor_iterations, 1);
+    if (threads.empty()) {
+        int max_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int n = 1; n < max_threads; n *= 2) {
+            threads.push_back(n);
+        }
+        threads.push_back(max_threads);
+    }
+    for (auto &n : threads) {
+        n = std::max(n, 1);
+    }
+    return true;
+}
+
+ScalingBenchmark::ScalingBenchmark(const ScalingSettings &settings) : _settings(settings) {}
+
+void ScalingBenchmark::run() {
+    const int n = _settings.size;
+
+    std::cout << "Scaling benchmark: " << _settings.problem << ", " << n << " x " << n << " cells per worker, "
+              << _settings.steps << " steps, " << _settings.sor_iterations << " SOR iterations per step\n";
+
+    std::vector<long> strong_cells, weak_cells;
+    std::vector<Timing> strong, weak;
+    for (int threads : _settings.threads) {
+        strong_cells.push_back(static_cast<long>(n) * n);
+        strong.push_back(run_problem(n, n, threads));
+
+        // The cavity grows in y direction, the channel in flow direction
+        int nx = _settings.problem == "channel" ? n * threads : n;
+        int ny = _settings.problem == "channel" ? n : n * threads;
+        weak_cells.push_back(static_cast<long>(nx) * ny);
+        weak.push_back(run_problem(nx, ny, threads));
+    }
+    Parallel::set_num_threads(1);
+
+    print_table("Strong scaling", _settings.threads, strong_cells, strong, false);
+    print_table("Weak scaling", _settings.threads, weak_cells, weak, true);
+}
+
+ScalingBenchmark::Timing ScalingBenchmark::run_problem(int nx, int ny, int threads) {
+    Parallel::set_num_threads(threads);
+
+    Domain domain;
+    domain.imin = 0;
+    domain.jmin = 0;
+    domain.imax = nx + 2;
+    domain.jmax = ny + 2;
+    domain.size_x = nx;
+    domain.size_y = ny;
+    domain.domain_size_x = nx;
+    domain.domain_size_y = ny;
+    domain.dx = 1.0 / _settings.size;
+    domain.dy = 1.0 / _settings.size;
+
+    Grid grid;
+    std::vector<std::unique_ptr<Boundary>> boundaries;
+    if (_settings.problem == "channel") {
+        std::vector<std::vector<int>> geometry(nx + 2, std::vector<int>(ny + 2, 6));
+        for (int i = 1; i < nx + 1; ++i) {
+            for (int j = 1; j < ny + 1; ++j) {
+                geometry[i][j] = 0;
+            }
+        }
+        for (int j = 1; j < ny + 1; ++j) {
+            geometry[0][j] = 1;
+            geometry[nx + 1][j] = 2;
+        }
+        grid = Grid(geometry, domain);
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.fixed_wall_cells()));
+        boundaries.push_back(std::make_unique<InflowBoundary>(grid.inflow_cells(), 1.0, 0.0));
+        boundaries.push_back(std::make_unique<OutflowBoundary>(grid.outflow_cells(), 0.0));
+    } else {
+        grid = Grid("NONE", domain);
+        boundaries.push_back(std::make_unique<FixedWallBoundary>(grid.fixed_wall_cells()));
+        boundaries.push_back(
+            std::make_unique<MovingWallBoundary>(grid.moving_wall_cells(), LidDrivenCavity::wall_velocity));
+    }
+
+    Discretization discretization(domain.dx, domain.dy, 0.5);
+    Fields field(grid, 0.01, 0.05, 0.5, 0.0, 0.0, 0.0, 0.0, 0.0);
+    // Same iterates as SOR, but swept on all threads
+    WavefrontSOR sor(1.7);
+
+    using clock = std::chrono::steady_clock;
+    auto seconds = [](clock::time_point a, clock::time_point b) {
+        return std::chrono::duration<double>(b - a).count();
+    };
+
+    Timing timing;
+    for (int step = 0; step < _settings.steps; ++step) {
+        auto t0 = clock::now();
+        for (auto &boundary : boundaries) {
+            boundary->apply(field);
+        }
+        auto t1 = clock::now();
+        field.calculate_fluxes(grid);
+        field.calculate_rs(grid);
+        auto t2 = clock::now();
+        timing.boundary += seconds(t0, t1);
+        timing.compute += seconds(t1, t2);
+
+        for (int it = 0; it < _settings.sor_iterations; ++it) {
+            auto s0 = clock::now();
+            for (auto &boundary : boundaries) {
+                boundary->apply_pressure(field);
+            }
+            auto s1 = clock::now();
+            sor.sweep(field, grid);
+            auto s2 = clock::now();
+            PressureSolver::residual(field, grid);
+            auto s3 = clock::now();
+            timing.boundary += seconds(s0, s1);
+            timing.compute += seconds(s1, s2);
+            timing.reduction += seconds(s2, s3);
+        }
+
+        auto t3 = clock::now();
+        field.calculate_velocities(grid);
+        auto t4 = clock::now();
+        field.calculate_dt(grid);
+        auto t5 = clock::now();
+        timing.compute += seconds(t3, t4);
+        timing.reduction += seconds(t4, t5);
+    }
+
+    // A single solution file per run, charged to every step
+    std::string file_name = (std::filesystem::temp_directory_path() / "fluidchen_scaling.vtk").string();
+    auto w0 = clock::now();
+    VTKOutput::write(file_name, grid, field, OutputSettings(), false);
+    auto w1 = clock::now();
+    std::remove(file_name.c_str());
+    timing.io = seconds(w0, w1);
+
+    timing.compute /= _settings.steps;
+    timing.boundary /= _settings.steps;
+    timing.reduction /= _settings.steps;
+    timing.io /= _settings.steps;
+    return timing;
+}
+
+void ScalingBenchmark::print_table(const std::string &title, const std::vector<int> &threads,
+                                   const std::vector<long> &cells, const std::vector<Timing> &timings,
+                                   bool weak) const {
+    std::cout << "\n" << title << " (time per step in ms)\n";
+    std::cout << std::setw(8) << "threads" << std::setw(12) << "cells" << std::setw(11) << "total" << std::setw(11)
+              << "compute" << std::setw(11) << "boundary" << std::setw(11) << "reduction" << std::setw(11) << "I/O"
+              << std::setw(10) << "speedup" << std::setw(12) << "efficiency" << "\n";
+
+    const double t1 = timings.front().total();
+    const int p1 = threads.front();
+    for (std::size_t k = 0; k < timings.size(); ++k) {
+        const Timing &t = timings[k];
+        // Strong: T1 / (p Tp), weak: T1 / Tp, both relative to the first thread count
+        double speedup = t1 / t.total();
+        double efficiency = weak ? speedup : speedup * p1 / threads[k];
+        if (weak) speedup *= static_cast<double>(threads[k]) / p1;
+
+        std::cout << std::fixed << std::setw(8) << threads[k] << std::setw(12) << cells[k] << std::setprecision(3)
+                  << std::setw(11) << t.total() * 1e3 << std::setw(11) << t.compute * 1e3 << std::setw(11)
+                  << t.boundary * 1e3 << std::setw(11) << t.reduction * 1e3 << std::setw(11) << t.io * 1e3
+                  << std::setprecision(2) << std::setw(10) << speedup << std::setw(11) << efficiency * 100 << "%\n";
+    }
+    std::cout << std::defaultfloat;
+}
@@ -0,0 +1,70 @@
+#include "SteadyState.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+SteadyState::SteadyState(double tolerance, int steps, bool max_norm, bool energy_eq)
+    : _tolerance(tolerance), _steps(std::max(steps, 1)), _max_norm(max_norm), _num_fields(energy_eq ? 4 : 3) {}
+
+bool SteadyState::update(const Fields &field, Grid &grid, double dt) {
+    const std::array<const Matrix<double> *, 4> fields{&field.u_matrix(), &field.v_matrix(), &field.p_matrix(),
+                                                       &field.t_matrix()};
+    const auto &cells = grid.fluid_cells();
+
+    if (!_has_previous) {
+        for (int f = 0; f < _num_fields; ++f) {
+            _previous[f] = *fields[f];
+        }
+        _has_previous = true;
+        return false;
+    }
+
+    bool below = true;
+    for (int f = 0; f < _num_fields; ++f) {
+        const Matrix<double> &current = *fields[f];
+        Matrix<double> &previous = _previous[f];
+
+        // The pressure level is arbitrary, its mean change is removed
+        double mean_change = 0.0;
+        double mean_value = 0.0;
+        if (f == 2) {
+            for (auto cell : cells) {
+                mean_change += current.get(cell->i(), cell->j()) - previous.get(cell->i(), cell->j());
+                mean_value += current.get(cell->i(), cell->j());
+            }
+            mean_change /= cells.size();
+            mean_value /= cells.size();
+        }
+
+        double sum = 0.0;
+        double max_change = 0.0;
+        double magnitude = 0.0;
+        for (auto cell : cells) {
+            int i = cell->i();
+            int j = cell->j();
+            double change = current.get(i, j) - previous.get(i, j) - mean_change;
+            sum += change * change;
+            max_change = std::max(max_change, std::fabs(change));
+            magnitude = std::max(magnitude, std::fabs(current.get(i, j) - mean_value));
+            previous.get(i, j) = current.get(i, j);
+        }
+
+        // A field at rest everywhere is measured in absolute terms
+        double scale = magnitude > 0.0 ? 1.0 / (magnitude * dt) : 1.0 / dt;
+        _l2[f] = std::sqrt(sum / cells.size()) * scale;
+        _max[f] = max_change * scale;
+        below = below && (_max_norm ? _max[f] : _l2[f]) < _tolerance;
+    }
+
+    _below = below ? _below + 1 : 0;
+    return steady();
+}
+
+void SteadyState::report(std::ostream &out) const {
+    const char *names[] = {"U", "V", "P", "T"};
+    out << "Relative change per unit time (L2 / max):";
+    for (int f = 0; f < _num_fields; ++f) {
+        out << " " << names[f] << " " << _l2[f] << " / " << _max[f];
+    }
+    out << "\n";
+}
@@ -0,0 +1,95 @@
+#include "StepLog.hpp"
+#include "PerfCounters.hpp"
+#include "Trace.hpp"
+
+#include <cstring>
+#include <iostream>
+
+const char *step_phase_name(step_phase phase) {
+    switch (phase) {
+    case step_phase::BOUNDARY:
+        return "boundary";
+    case step_phase::TEMPERATURE:
+        return "temperature";
+    case step_phase::FLUXES:
+        return "fluxes";
+    case step_phase::RHS:
+        return "rhs";
+    case step_phase::PRESSURE:
+        return "pressure";
+    case step_phase::VELOCITIES:
+        return "velocities";
+    case step_phase::OUTPUT:
+        return "output";
+    default:
+        return "unknown";
+    }
+}
+
+void PhaseTimer::start(step_phase phase) {
+    if (_counters) _counters->start(phase);
+    _start[static_cast<int>(phase)] = std::chrono::steady_clock::now();
+}
+
+void PhaseTimer::stop(step_phase phase) {
+    auto end = std::chrono::steady_clock::now();
+    _elapsed[static_cast<int>(phase)] +=
+        std::chrono::duration<double>(end - _start[static_cast<int>(phase)]).count();
+    if (_counters) _counters->stop(phase);
+    if (Trace::enabled()) {
+        Trace::record(step_phase_name(phase), "phase", Trace::since_start(_start[static_cast<int>(phase)]),
+                      Trace::since_start(end));
+    }
+}
+
+double PhaseTimer::elapsed(step_phase phase) const { return _elapsed[static_cast<int>(phase)]; }
+
+void PhaseTimer::reset() { _elapsed.fill(0.0); }
+
+void PhaseTimer::attach(PerfCounters *counters) { _counters = counters; }
+
+StepLog::~StepLog() { close(); }
+
+void StepLog::open(const std::string &file_name, int buffer_records) {
+    _file.open(file_name, std::ios::binary);
+    if (!_file.is_open()) {
+        std::cerr << "Step log " << file_name << " could not be opened." << std::endl;
+        return;
+    }
+    _buffer.reserve(buffer_records);
+
+    StepLogHeader header{};
+    std::memcpy(header.magic, step_log_magic, sizeof(header.magic));
+    header.record_size = sizeof(StepRecord);
+    header.num_phases = num_step_phases;
+    for (int k = 0; k < num_step_phases; ++k) {
+        std::strncpy(header.phase_names[k], step_phase_name(static_cast<step_phase>(k)),
+                     sizeof(header.phase_names[k]) - 1);
+    }
+    _file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+}
+
+void StepLog::write(const StepRecord &record) {
+    if (!_file.is_open()) return;
+
+    _buffer.push_back(record);
+    if (_buffer.size() == _buffer.capacity()) {
+        flush();
+    }
+}
+
+void StepLog::flush() {
+    if (!_file.is_open() || _buffer.empty()) return;
+
+    _file.write(reinterpret_cast<const char *>(_buffer.data()), _buffer.size() * sizeof(StepRecord));
+    _buffer.clear();
+}
+
+void StepLog::close() {
+    if (!_file.is_open()) return;
+
+    flush();
+    _file.close();
+}
+
+bool StepLog::is_open() const { return _file.is_open(); }
@@ -0,0 +1,92 @@
+#include "Trace.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+bool Trace::_enabled = false;
+Trace::clock::time_point Trace::_start;
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    const char *category;
+    int64_t begin;
+    int64_t end;
+    int64_t arg;
+};
+
+/// Events of one thread
+struct TraceBuffer {
+    int tid;
+    std::vector<TraceEvent> events;
+};
+
+std::mutex registry_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> registry;
+
+/// Buffer of the calling thread, registered on first use
+TraceBuffer &thread_buffer() {
+    thread_local TraceBuffer *buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(std::make_unique<TraceBuffer>());
+        buffer = registry.back().get();
+        buffer->tid = registry.size() - 1;
+        buffer->events.reserve(1 << 16);
+    }
+    return *buffer;
+}
+
+} // namespace
+
+void Trace::enable() {
+    // The enabling thread is listed first
+    thread_buffer();
+    _start = clock::now();
+    _enabled = true;
+}
+
+int64_t Trace::since_start(clock::time_point time) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(time - _start).count();
+}
+
+void Trace::record(const char *name, const char *category, int64_t begin, int64_t end, int64_t arg) {
+    thread_buffer().events.push_back({name, category, begin, end, arg});
+}
+
+void Trace::write(const std::string &file_name) {
+    std::ofstream file(file_name);
+    if (!file.is_open()) {
+        std::cerr << "Trace file " << file_name << " could not be opened." << std::endl;
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+
+    // Times in microseconds with nanosecond resolution
+    file << std::fixed << std::setprecision(3);
+    file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+    bool first = true;
+    for (auto &buffer : registry) {
+        file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": " << buffer->tid
+             << ", \"args\": {\"name\": \"" << (buffer->tid == 0 ? "main" : "worker " + std::to_string(buffer->tid))
+             << "\"}}";
+        first = false;
+
+        for (auto &event : buffer->events) {
+            file << ",\n{\"name\": \"" << event.name << "\", \"cat\": \"" << event.category
+                 << "\", \"ph\": \"X\", \"pid\": 0, \"tid\": " << buffer->tid << ", \"ts\": " << event.begin * 1e-3
+                 << ", \"dur\": " << (event.end - event.begin) * 1e-3;
+            if (event.arg >= 0) {
+                file << ", \"args\": {\"value\": " << event.arg << "}";
+            }
+            file << "}";
+        }
+    }
+    file << "\n]}\n";
+}
@@ -2,12 +2,23 @@
 #include <string>
 
 #include "Case.hpp"
+#include "Scaling.hpp"
 
 void printIntro();
 
 int main(int argn, char **args) {
 
-    if (argn > 1) {
+    if (argn > 1 && std::string(args[1]) == "--scaling") {
+        ScalingSettings settings;
+        if (!settings.parse(argn - 2, args + 2)) {
+            std::cout << "Example usage: /path/to/fluidchen --scaling [cavity|channel] [--size N] "
+                         "[--threads 1,2,4] [--steps N] [--sor-iterations N]"
+                      << std::endl;
+            return 1;
+        }
+        ScalingBenchmark(settings).run();
+
+    } else if (argn > 1) {
         std::string file_name{args[1]};
         Case problem(file_name, argn, args);
         problem.printIntro();
@@ -16,5 +27,7 @@ int main(int argn, char **args) {
     } else {
         std::cout << "Error: No input file is provided to fluidchen." << std::endl;
         std::cout << "Example usage: /path/to/fluidchen /path/to/input_data.dat" << std::endl;
+        std::cout << "Options: --threads N, --max-steps N, --no-output, --bench-json summary.json" << std::endl;
+        std::cout << "Scaling benchmark: /path/to/fluidchen --scaling [cavity|channel] [options]" << std::endl;
     }
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+// Decompresses a solution file written by fluidchen (output_format compressed) to a .vtk file.
+//
+// Usage: fcz2vtk <case>_<rank>.<n>.fcz [output.vtk]
+
+#include <iostream>
+#include <string>
+
+#include "Compression.hpp"
+#include "Output.hpp"
+
+int main(int argn, char **args) {
+    if (argn < 2) {
+        std::cout << "Error: No compressed solution file is provided to fcz2vtk." << std::endl;
+        std::cout << "Example usage: /path/to/fcz2vtk /path/to/case_0.1.fcz [output.vtk]" << std::endl;
+        return 1;
+    }
+
+    std::string input_name(args[1]);
+    std::string output_name;
+    if (argn > 2) {
+        output_name = args[2];
+    } else {
+        // Replace the extension, keep the rank and timestep of the name
+        std::size_t dot = input_name.rfind(".fcz");
+        output_name = (dot == std::string::npos ? input_name : input_name.substr(0, dot)) + ".vtk";
+    }
+
+    Snapshot snapshot = SnapshotCompression::read(input_name);
+    if (snapshot.x.empty()) {
+        return 1;
+    }
+
+    VTKOutput::write(output_name, snapshot);
+    std::cout << "Written " << output_name << std::endl;
+    return 0;
+}
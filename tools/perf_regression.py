@@ -0,0 +1,194 @@
+#!/usr/bin/env python3
+"""End-to-end performance regression check over the example cases.
+
+Runs every .dat file under example_cases/ for a fixed number of timesteps with
+output suppressed, collects the --bench-json summaries of fluidchen and compares
+them against a stored baseline. With --baseline-commit the baseline is
+instead measured in the same session with a build of the given commit, the
+runs of both executables alternating, so that the timings can be compared
+at a tight tolerance on any machine.
+
+Returns
+0 if no case regressed
+1 on a regression or a failed run
+
+Usage:
+    tools/perf_regression.py --fluidchen build/fluidchen [--steps 200]
+    tools/perf_regression.py --fluidchen build/fluidchen --update-baseline
+    tools/perf_regression.py --fluidchen build/fluidchen --baseline-commit main [--cmake-args="-DVTK_DIR=..."]
+"""
+
+import argparse
+import glob
+import json
+import os
+import shutil
+import subprocess
+import sys
+import tempfile
+
+REPO = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+
+def run_case(fluidchen, dat_file, steps, work_dir):
+    """Runs one case in a scratch copy of its directory and returns its summary."""
+    case_dir = os.path.dirname(dat_file)
+    scratch = os.path.join(work_dir, os.path.basename(case_dir))
+    if not os.path.isdir(scratch):
+        shutil.copytree(case_dir, scratch)
+    dat = os.path.join(scratch, os.path.basename(dat_file))
+    summary = os.path.join(work_dir, os.path.splitext(os.path.basename(dat_file))[0] + ".json")
+
+    cmd = [fluidchen, dat, "--max-steps", str(steps), "--no-output", "--bench-json", summary]
+    proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, universal_newlines=True)
+    if proc.returncode != 0 or not os.path.isfile(summary):
+        print("  run failed: " + " ".join(cmd))
+        print(proc.stderr)
+        return None
+    with open(summary) as f:
+        return json.load(f)
+
+
+def build_commit(commit, cmake_args, work_dir):
+    """Builds fluidchen at a commit in a scratch worktree and returns the path of the executable."""
+    source = os.path.join(work_dir, "baseline_src")
+    build = os.path.join(work_dir, "baseline_build")
+    print("Building baseline " + commit)
+    steps = [
+        ["git", "-C", REPO, "worktree", "add", "--detach", source, commit],
+        ["cmake", "-S", source, "-B", build] + cmake_args.split(),
+        ["cmake", "--build", build, "--target", "fluidchen", "-j", str(os.cpu_count() or 1)],
+    ]
+    for cmd in steps:
+        proc = subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE, universal_newlines=True)
+        if proc.returncode != 0:
+            print("  build failed: " + " ".join(cmd))
+            print(proc.stderr)
+            return None
+    return os.path.join(build, "fluidchen")
+
+
+def remove_worktree(work_dir):
+    """Removes the scratch worktree of the baseline build, if any."""
+    source = os.path.join(work_dir, "baseline_src")
+    if os.path.isdir(source):
+        subprocess.run(["git", "-C", REPO, "worktree", "remove", "--force", source],
+                       stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL)
+
+
+def compare(name, result, reference, args):
+    """Returns the list of regressions of one case."""
+    checks = [
+        ("time_per_step", args.time_tolerance),
+        ("sor_iterations_per_step", args.iteration_tolerance),
+        ("peak_rss_kb", args.memory_tolerance),
+    ]
+    regressions = []
+    for key, tolerance in checks:
+        if tolerance < 0 or key not in reference:
+            continue
+        old, new = reference[key], result[key]
+        change = (new - old) / old if old > 0 else 0.0
+        status = "REGRESSION" if change > tolerance else "ok"
+        print("  {:<26} {:>14.6g} {:>14.6g} {:>+9.1%}  {}".format(key, old, new, change, status))
+        if change > tolerance:
+            regressions.append("{}: {} increased by {:.1%} (tolerance {:.1%})".format(name, key, change, tolerance))
+    if result["steps"] != reference.get("steps", result["steps"]):
+        regressions.append("{}: ran {} steps, baseline ran {}".format(name, result["steps"], reference["steps"]))
+    return regressions
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--fluidchen", required=True, help="path to the fluidchen executable")
+    parser.add_argument("--steps", type=int, default=200, help="number of timesteps per case")
+    parser.add_argument("--repeat", type=int, default=3,
+                        help="runs per case, the fastest one is kept to reduce timing noise")
+    parser.add_argument("--cases", default=os.path.join(REPO, "example_cases"), help="directory of the cases")
+    parser.add_argument("--baseline", default=os.path.join(REPO, "bench", "perf_baseline.json"))
+    parser.add_argument("--baseline-commit",
+                        help="build this commit and measure the baseline with it instead of reading --baseline")
+    parser.add_argument("--cmake-args", default="", help="extra arguments to configure the baseline build")
+    parser.add_argument("--results", help="write the collected summaries to this file")
+    parser.add_argument("--update-baseline", action="store_true", help="store the results as new baseline")
+    parser.add_argument("--time-tolerance", type=float, default=0.10,
+                        help="allowed relative increase of the time per step, negative to disable")
+    parser.add_argument("--iteration-tolerance", type=float, default=0.02,
+                        help="allowed relative increase of the SOR iterations per step, negative to disable")
+    parser.add_argument("--memory-tolerance", type=float, default=0.20,
+                        help="allowed relative increase of the peak RSS, negative to disable")
+    args = parser.parse_args()
+
+    fluidchen = os.path.abspath(args.fluidchen)
+    dat_files = sorted(glob.glob(os.path.join(args.cases, "*", "*.dat")))
+    if not dat_files:
+        print("No cases found in " + args.cases)
+        return 1
+
+    results = {}
+    baseline = {}
+    failed = []
+    work_dir = tempfile.mkdtemp(prefix="fluidchen_perf_")
+    try:
+        reference = None
+        if args.baseline_commit:
+            reference = build_commit(args.baseline_commit, args.cmake_args, work_dir)
+            if reference is None:
+                return 1
+
+        for dat_file in dat_files:
+            name = os.path.splitext(os.path.basename(dat_file))[0]
+            print("Running " + name)
+            runs, reference_runs = [], []
+            for _ in range(max(args.repeat, 1)):
+                runs.append(run_case(fluidchen, dat_file, args.steps, work_dir))
+                if reference:
+                    reference_runs.append(run_case(reference, dat_file, args.steps, work_dir))
+            if None in runs or None in reference_runs:
+                failed.append(name + ": run failed")
+                continue
+            results[name] = min(runs, key=lambda summary: summary["time_per_step"])
+            if reference:
+                baseline[name] = min(reference_runs, key=lambda summary: summary["time_per_step"])
+    finally:
+        remove_worktree(work_dir)
+        shutil.rmtree(work_dir, ignore_errors=True)
+
+    if args.results:
+        with open(args.results, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.update_baseline:
+        with open(args.baseline, "w") as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+        print("Baseline written to " + args.baseline)
+        return 1 if failed else 0
+
+    if not args.baseline_commit:
+        if not os.path.isfile(args.baseline):
+            print("No baseline found at " + args.baseline + ", run with --update-baseline first.")
+            return 1
+        with open(args.baseline) as f:
+            baseline = json.load(f)
+
+    regressions = list(failed)
+    print("\n  {:<26} {:>14} {:>14} {:>9}".format("", "baseline", "current", "change"))
+    for name, result in sorted(results.items()):
+        print(name)
+        if name not in baseline:
+            print("  not in baseline, skipped")
+            continue
+        regressions += compare(name, result, baseline[name], args)
+
+    if regressions:
+        print("\nPerformance regressions:")
+        for regression in regressions:
+            print("  " + regression)
+        return 1
+
+    print("\nNo performance regressions.")
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,85 @@
+// Converts the binary step log written by fluidchen (log_format binary) to CSV.
+//
+// Usage: steplog2csv <case>_steps.bin [output.csv]
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "StepLog.hpp"
+
+int main(int argn, char **args) {
+    if (argn < 2) {
+        std::cout << "Error: No step log is provided to steplog2csv." << std::endl;
+        std::cout << "Example usage: /path/to/steplog2csv /path/to/case_steps.bin [output.csv]" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(args[1], std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Step log " << args[1] << " could not be opened." << std::endl;
+        return 1;
+    }
+
+    // The phase names and the records are read with the sizes given in the header,
+    // so that logs written by a solver with other phases can be decoded
+    StepLogHeader header;
+    const std::size_t fixed_header = offsetof(StepLogHeader, phase_names);
+    const std::size_t name_size = sizeof(header.phase_names[0]);
+    file.read(reinterpret_cast<char *>(&header), fixed_header);
+    if (!file || std::memcmp(header.magic, step_log_magic, sizeof(header.magic)) != 0) {
+        std::cerr << args[1] << " is not a fluidchen step log." << std::endl;
+        return 1;
+    }
+    const std::size_t fixed_record = offsetof(StepRecord, phase_time);
+    if (header.num_phases < 0 || header.record_size <= 0 ||
+        static_cast<std::size_t>(header.record_size) != fixed_record + header.num_phases * sizeof(double)) {
+        std::cerr << "Step log record size " << header.record_size << " does not match its " << header.num_phases
+                  << " phases." << std::endl;
+        return 1;
+    }
+    std::vector<std::string> phase_names(header.num_phases);
+    for (auto &name : phase_names) {
+        char buffer[sizeof(header.phase_names[0])];
+        file.read(buffer, name_size);
+        name.assign(buffer, strnlen(buffer, name_size));
+    }
+
+    std::ofstream output_file;
+    if (argn > 2) {
+        output_file.open(args[2]);
+    }
+    std::ostream &out = argn > 2 ? output_file : std::cout;
+    out << std::setprecision(std::numeric_limits<double>::digits10);
+
+    out << "t,dt,iterations,residual";
+    for (int k = 0; k < header.num_phases; ++k) {
+        out << "," << phase_names[k] << "_s";
+    }
+    out << "\n";
+
+    std::vector<char> records(4096 * header.record_size);
+    while (file) {
+        file.read(records.data(), records.size());
+        int num_records = file.gcount() / header.record_size;
+        for (int r = 0; r < num_records; ++r) {
+            const char *record = records.data() + r * header.record_size;
+            StepRecord fixed;
+            std::memcpy(&fixed, record, fixed_record);
+            out << fixed.t << "," << fixed.dt << "," << fixed.iterations << "," << fixed.residual;
+            for (int k = 0; k < header.num_phases; ++k) {
+                double phase_time;
+                std::memcpy(&phase_time, record + fixed_record + k * sizeof(double), sizeof(double));
+                out << "," << phase_time;
+            }
+            out << "\n";
+        }
+    }
+
+    return 0;
+}